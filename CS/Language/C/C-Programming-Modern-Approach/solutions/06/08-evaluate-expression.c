@@ -2,7 +2,17 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <ctype.h>
+#include <errno.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../common/number.h"
+#include "../common/stack.h"
+#include "expr/columns.h"
+#include "expr/parallel.h"
+#include "expr/program.h"
+#include "expr/server.h"
+#include "expr/session.h"
 
 void print_repeated(char* repeated, int times) {
     for (int i = 0; i < times; ++i) {
@@ -11,94 +21,46 @@ void print_repeated(char* repeated, int times) {
     printf("\n");
 }
 
-typedef struct StackNode {
-    union {
-        char op;
-        double num;
-    } data;
-    struct StackNode *next;
-} StackNode;
-
-typedef struct Stack {
-    StackNode *top;
-} Stack;
-
-Stack* init_stack() {
-    Stack *stack = (Stack*)malloc(sizeof(Stack));
-    stack->top = NULL;
-    return stack;
-}
+// The operations and the numbers are kept in two stacks of `stack.h`, so
+// neither pushing nor popping allocates anything for a usual expression.
 
-bool is_empty(Stack *stack) {
-    return stack->top == NULL;
-}
+STACK_DEFINE(OpStack, op_stack, char, 32)
+STACK_DEFINE(NumStack, num_stack, double, 32)
 
-void push_op(Stack *stack, char op) {
-    StackNode *new_node = (StackNode*)malloc(sizeof(StackNode));
-    new_node->data.op = op;
-    new_node->next = stack->top;
-    stack->top = new_node;
+void push_op(OpStack *stack, char op) {
+    op_stack_push(stack, op);
 }
 
-void push_num(Stack *stack, double num) {
-    StackNode *new_node = (StackNode*)malloc(sizeof(StackNode));
-    new_node->data.num = num;
-    new_node->next = stack->top;
-    stack->top = new_node;
+void push_num(NumStack *stack, double num) {
+    num_stack_push(stack, num);
 }
 
-char pop_op(Stack *stack) {
-    if (is_empty(stack)) return EOF;
-
-    StackNode *temp = stack->top;
-    char temp_data = temp->data.op;
-    stack->top = stack->top->next;
-
-    free(temp);
-    temp = NULL;
-
-    return temp_data;
+char pop_op(OpStack *stack) {
+    if (op_stack_is_empty(stack)) return EOF;
+    return op_stack_pop(stack);
 }
 
-double pop_num(Stack *stack) {
-    if (is_empty(stack)) return 0.0;
-
-    StackNode *temp = stack->top;
-    double temp_data = temp->data.num;
-    stack->top = stack->top->next;
-
-    free(temp);
-    temp = NULL;
-
-    return temp_data;
+double pop_num(NumStack *stack) {
+    if (num_stack_is_empty(stack)) return 0.0;
+    return num_stack_pop(stack);
 }
 
-void print_stack_op(Stack *stack) {
-    StackNode *read = stack->top;
-
-    while (read != NULL) {
-        printf("%c ", read->data.op);
-        read = read->next;
+void print_stack_op(OpStack *stack) {
+    for (int i = stack->length - 1; i >= 0; --i) {
+        printf("%c ", stack->items[i]);
     }
     printf("]");
 }
 
-void print_stack_num(Stack *stack) {
-    StackNode *read = stack->top;
-
-    while (read != NULL) {
-        printf("%lf ", read->data.num);
-        read = read->next;
+void print_stack_num(NumStack *stack) {
+    for (int i = stack->length - 1; i >= 0; --i) {
+        printf("%lf ", stack->items[i]);
     }
     printf("]");
 }
 
-void clear(Stack *stack) {
-    stack->top = NULL;
-}
-
-char getchar_stacktop(Stack *stack) {
-    return is_empty(stack) ? EOF : stack->top->data.op;
+char getchar_stacktop(OpStack *stack) {
+    return op_stack_is_empty(stack) ? EOF : op_stack_top(stack);
 }
 
 bool is_op(char check) {
@@ -125,9 +87,12 @@ int get_priority(char op) {
     }
 }
 
+// The digits are read by `number_parse` (see `common/number.h`), which
+// rounds the number once to the nearest double, like `strtod`, and also
+// reads exponents like 1.5e-3.
+
 double parse_num(char *input, int *index) {
-    double num = 0.0, scale = 1.0;
-    bool has_met_dot;
+    double num = 0.0;
 
     if (
         input[*index] == '-' &&
@@ -138,25 +103,10 @@ double parse_num(char *input, int *index) {
         return num;
     }
 
-    while (
-        input[*index] != '\0' &&
-        (isdigit(input[*index]) || input[*index] == '.')
-    ) {
-        if (input[*index] == '.') {
-            has_met_dot = true;
-            (*index)++;
-            continue;
-        }
-
-        if (has_met_dot) {
-            scale *= 0.1;
-            num += (input[*index] - '0') * scale;
-        } else {
-            num = num * 10 + (input[*index] - '0');
-        }
-
-        (*index)++;
-    }
+    const char *start = input + *index;
+    const char *end = number_parse(start, start + strlen(start), &num);
+    if (end == start) end++;        // ← A lone '.' is 0.
+    *index = end - input;
 
     return num;
 }
@@ -176,7 +126,7 @@ double calculate(double a, double b, char op) {
     }
 }
 
-void print_stack_state(Stack *op_stack, Stack *num_stack) {
+void print_stack_state(OpStack *op_stack, NumStack *num_stack) {
     print_repeated("\n", 0);
     printf("→ Operation Stack: ");
     print_stack_op(op_stack);
@@ -187,8 +137,13 @@ void print_stack_state(Stack *op_stack, Stack *num_stack) {
 }
 
 double calculate_expression(char *expr) {
-    Stack *op_stack = init_stack();
-    Stack *num_stack = init_stack();
+    OpStack ops;
+    NumStack nums;
+    OpStack *op_stack = &ops;
+    NumStack *num_stack = &nums;
+
+    op_stack_init(op_stack);
+    num_stack_init(num_stack);
 
     int i = 0;
     int len = strlen(expr);
@@ -214,8 +169,10 @@ double calculate_expression(char *expr) {
                 print_stack_state(op_stack, num_stack);
             } else if (expr[i] == ')') {
                 while (getchar_stacktop(op_stack) != '(') {
-                    if (is_empty(op_stack)) {
+                    if (op_stack_is_empty(op_stack)) {
                         printf("[Error] : Lack left parenthesis\n");
+                        op_stack_free(op_stack);
+                        num_stack_free(num_stack);
                         return 0.0;
                     }
                     double b = pop_num(num_stack);
@@ -231,7 +188,7 @@ double calculate_expression(char *expr) {
                 i++;
             } else {
                 while (
-                    !is_empty(op_stack) &&
+                    !op_stack_is_empty(op_stack) &&
                     get_priority(getchar_stacktop(op_stack)) >= get_priority(expr[i])
                 ) {
                     double b = pop_num(num_stack);
@@ -248,11 +205,13 @@ double calculate_expression(char *expr) {
             }
         } else {
             printf("[Error] : Invalid character %c\n", expr[i]);
+            op_stack_free(op_stack);
+            num_stack_free(num_stack);
             return 0.0;
         }
     }
 
-    while (!is_empty(op_stack)) {
+    while (!op_stack_is_empty(op_stack)) {
         double b = pop_num(num_stack);
         double a = pop_num(num_stack);
         char op = pop_op(op_stack);
@@ -263,13 +222,376 @@ double calculate_expression(char *expr) {
 
     double res = pop_num(num_stack);
 
-    free(op_stack);
-    free(num_stack);
+    op_stack_free(op_stack);
+    num_stack_free(num_stack);
 
     return res;
 }
 
-int main(void) {
+// Usage: 08-evaluate-expression
+//        08-evaluate-expression -e expression < bindings
+//        08-evaluate-expression -f file [-j threads]
+//        08-evaluate-expression -r [-m memory]
+//        08-evaluate-expression -s socket [-m memory]
+//        08-evaluate-expression -c socket
+//
+// Without options, reads one expression and shows the stacks at every step of
+// its evaluation.
+//
+// With -e, the expression is compiled once (see `expr/program.h`) and then
+// evaluated for every line of the bindings. The first line names the
+// variables separated by commas, and every other line gives their values in
+// the same order. One value of the expression is written per line of values:
+//
+//   echo "x, y
+//   1, 2
+//   3.5, -1" | 08-evaluate-expression -e "x * (y + 1)"
+//
+// writes 3 and 0. Columns the expression doesn't use are ignored. The rows are
+// evaluated in batches, column by column.
+//
+// With -f, every line of the file is an expression without variables, and its
+// value is written on a line of its own, in the same order. The file is
+// evaluated by `threads` threads (one per processor by default, see
+// `expr/parallel.h`), and the number of lines per second is reported on
+// stderr at the end.
+//
+// With -r, reads requests, one per line, until the end of the input, and
+// answers each one with a line: an expression, then ';' and the values of its
+// variables,
+//
+//   x * (y + 1); x = 1, y = 2
+//
+// gives 3, or "error: " and why not. The expressions compiled last are kept
+// in a cache (see `expr/cache.h`) of at most `memory` bytes (16M by default,
+// with an optional K, M or G), so an expression that comes back is only
+// evaluated again (see `expr/session.h`). The line ":stats" gives the hits
+// and misses of the cache. The answers are written as soon as no more
+// requests are waiting.
+//
+// With -s, answers the same requests for every client of a UNIX domain
+// socket made at `socket` (see `expr/server.h`), until SIGINT or SIGTERM.
+// With -c, sends the requests of the standard input to that socket and
+// writes the answers:
+//
+//   08-evaluate-expression -s /tmp/expr.sock &
+//   echo "x * (y + 1); x = 1, y = 2" | 08-evaluate-expression -c /tmp/expr.sock
+
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+// Reads the names of the header into `names`, returns their number. An empty
+// field is a column without a name, so that the columns after it keep their
+// places.
+
+static int read_header(char *line, char (*names)[EXPR_MAX_NAME], int max_names) {
+    int num_of_names = 0;
+
+    line[strcspn(line, "\n\r")] = '\0';
+    if (*line == '\0') return 0;
+
+    char *field = line;
+    while (field != NULL && num_of_names < max_names) {
+        char *comma = strchr(field, ',');
+        if (comma != NULL) *comma = '\0';
+
+        while (*field == ' ' || *field == '\t') field++;
+        int length = strlen(field);
+        while (length > 0 && (field[length - 1] == ' ' || field[length - 1] == '\t')) length--;
+        if (length >= EXPR_MAX_NAME) length = EXPR_MAX_NAME - 1;
+
+        memcpy(names[num_of_names], field, length);
+        names[num_of_names][length] = '\0';
+        num_of_names++;
+        field = comma != NULL ? comma + 1 : NULL;
+    }
+    return num_of_names;
+}
+
+// Reads `num_of_columns` numbers separated by commas. Returns false if the
+// line has fewer of them or something else.
+
+static bool read_row(const char *line, size_t length, double *row, int num_of_columns) {
+    const char *p = line, *line_end = line + length;
+
+    for (int c = 0; c < num_of_columns; ++c) {
+        while (*p == ' ' || *p == '\t') p++;
+        const char *end = number_parse(p, line_end, &row[c]);
+        if (end == p) return false;
+
+        p = end;
+        while (*p == ' ' || *p == '\t') p++;
+        if (c < num_of_columns - 1) {
+            if (*p != ',') return false;
+            p++;
+        }
+    }
+    return *p == '\0' || *p == '\n' || *p == '\r' || *p == ',';
+}
+
+// The rows are collected into one column per variable, BATCH_ROWS rows at a
+// time, and each batch is evaluated column by column (see `expr/columns.h`).
+
+#define BATCH_ROWS (1 << 16)
+
+typedef struct {
+    double **columns;       // ← columns[v] holds the values of variable v.
+    double *results;
+    unsigned char *division_by_zero;
+    bool *is_valid;
+    long *line_numbers;
+    long num_of_rows;
+} Batch;
+
+static void* allocate(size_t size) {
+    void *memory = malloc(size);
+    if (memory == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:evaluate_bindings>\n");
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+static void write_batch(const Program *program, Batch *batch) {
+    expr_evaluate_columns(
+        program, (const double* const*)batch->columns, batch->num_of_rows,
+        batch->results, batch->division_by_zero
+    );
+
+    for (long r = 0; r < batch->num_of_rows; ++r) {
+        if (!batch->is_valid[r]) {
+            printf("nan\n");
+            continue;
+        }
+        if (batch->division_by_zero[r])
+            fprintf(stderr, "[Error] : Division by zero in line %ld\n", batch->line_numbers[r]);
+        printf("%.17g\n", batch->results[r]);
+    }
+    batch->num_of_rows = 0;
+}
+
+static int evaluate_bindings(const char *source) {
+    Program program;
+    Batch batch = { .num_of_rows = 0 };
+    char *line = NULL;
+    size_t capacity = 0;
+    long line_number = 1;
+    int status = 0;
+
+    if (!expr_compile(&program, source)) {
+        fprintf(stderr, "[Error] : %s\n", program.error);
+        expr_free(&program);
+        return 1;
+    }
+    expr_optimize(&program);
+    if (getline(&line, &capacity, stdin) < 0) {
+        fprintf(stderr, "[Error] : Lack the line naming the variables\n");
+        expr_free(&program);
+        return 1;
+    }
+
+    int num_of_variables = program.num_of_variables;
+    int max_columns = strlen(line) / 2 + 1;
+    char (*names)[EXPR_MAX_NAME] = allocate(max_columns * EXPR_MAX_NAME);
+    double *row = allocate(max_columns * sizeof(double));
+    int *column_of = allocate((num_of_variables + 1) * sizeof(int));
+
+    int num_of_columns = read_header(line, names, max_columns);
+    for (int v = 0; v < num_of_variables; ++v) {
+        column_of[v] = -1;
+        for (int c = 0; c < num_of_columns; ++c) {
+            if (strcmp(names[c], program.variables[v]) == 0) column_of[v] = c;
+        }
+        if (column_of[v] < 0) {
+            fprintf(stderr, "[Error] : No column for the variable %s\n", program.variables[v]);
+            status = 1;
+        }
+    }
+
+    batch.columns = allocate((num_of_variables + 1) * sizeof(double*));
+    for (int v = 0; v < num_of_variables; ++v)
+        batch.columns[v] = allocate(BATCH_ROWS * sizeof(double));
+    batch.results = allocate(BATCH_ROWS * sizeof(double));
+    batch.division_by_zero = allocate(BATCH_ROWS);
+    batch.is_valid = allocate(BATCH_ROWS * sizeof(bool));
+    batch.line_numbers = allocate(BATCH_ROWS * sizeof(long));
+
+    setvbuf(stdout, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+    ssize_t length;
+    while (status == 0 && (length = getline(&line, &capacity, stdin)) >= 0) {
+        long r = batch.num_of_rows;
+        line_number++;
+
+        if (line[0] == '\n' || line[0] == '\0') continue;
+
+        batch.is_valid[r] = read_row(line, length, row, num_of_columns);
+        if (!batch.is_valid[r]) {
+            fprintf(stderr, "[Error] : Invalid values in line %ld\n", line_number);
+            for (int c = 0; c < num_of_columns; ++c) row[c] = 0.0;
+        }
+        for (int v = 0; v < num_of_variables; ++v)
+            batch.columns[v][r] = row[column_of[v]];
+        batch.line_numbers[r] = line_number;
+
+        if (++batch.num_of_rows == BATCH_ROWS) write_batch(&program, &batch);
+    }
+    if (status == 0) write_batch(&program, &batch);
+
+    for (int v = 0; v < num_of_variables; ++v) free(batch.columns[v]);
+    free(batch.columns);
+    free(batch.results);
+    free(batch.division_by_zero);
+    free(batch.is_valid);
+    free(batch.line_numbers);
+    free(line);
+    free(names);
+    free(row);
+    free(column_of);
+    expr_free(&program);
+    return status;
+}
+
+#define REQUEST_BUFFER_SIZE (1 << 16)
+#define DEFAULT_CACHE_BUDGET (16 << 20)
+
+// The requests are read with `read` as they come. All the whole lines read
+// are answered, and the answers are written out together before waiting for
+// more.
+
+static int evaluate_requests(size_t memory_budget) {
+    Session session;
+    ReplyBuffer reply = { .data = NULL };
+    size_t capacity = REQUEST_BUFFER_SIZE, start = 0, length = 0;
+    char *buffer = allocate(capacity);
+    bool reached_eof = false;
+
+    expr_session_init(&session, memory_budget);
+
+    while (!reached_eof || start < length) {
+        char *newline;
+        while ((newline = memchr(buffer + start, '\n', length - start)) != NULL) {
+            expr_session_answer(&session, buffer + start, newline - (buffer + start), &reply);
+            start = newline - buffer + 1;
+        }
+        if (reached_eof) {
+            if (start < length) expr_session_answer(&session, buffer + start, length - start, &reply);
+            break;
+        }
+        if (fwrite(reply.data, 1, reply.length, stdout) < reply.length || fflush(stdout) != 0) break;
+        reply.length = 0;
+
+        // Keep the beginning of the next line, in a larger buffer if it
+        // fills the whole one.
+        memmove(buffer, buffer + start, length - start);
+        length -= start;
+        start = 0;
+        if (length == capacity) {
+            capacity *= 2;
+            buffer = realloc(buffer, capacity);
+            if (buffer == NULL) {
+                fprintf(stderr, "[Error] : realloc failed in <function:evaluate_requests>\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        ssize_t count = read(STDIN_FILENO, buffer + length, capacity - length);
+        if (count > 0) {
+            length += count;
+        } else if (count == 0 || errno != EINTR) {
+            reached_eof = true;
+        }
+    }
+    fwrite(reply.data, 1, reply.length, stdout);
+    fflush(stdout);
+
+    ExprCache *cache = &session.cache;
+    fprintf(
+        stderr, "[Info] : %ld hits, %ld misses, %ld evictions, %ld expressions kept in %zu bytes\n",
+        cache->hits, cache->misses, cache->evictions, cache->num_of_entries, cache->memory_used
+    );
+    expr_session_free(&session);
+    expr_reply_free(&reply);
+    free(buffer);
+    return 0;
+}
+
+static int serve(const char *path, size_t memory_budget) {
+    ServerStats stats;
+
+    if (!expr_serve(path, memory_budget, &stats)) return 1;
+    fprintf(
+        stderr, "[Info] : %ld connections, %ld requests in %ld batches, at most %ld in one\n",
+        stats.num_of_connections, stats.num_of_requests, stats.num_of_batches, stats.largest_batch
+    );
+    return 0;
+}
+
+// "16M" is 16 << 20 bytes.
+
+static size_t parse_size(const char *text) {
+    char *end;
+    size_t size = strtoull(text, &end, 10);
+
+    switch (*end) {
+        case 'k' : case 'K' : return size << 10;
+        case 'm' : case 'M' : return size << 20;
+        case 'g' : case 'G' : return size << 30;
+        default  : return size;
+    }
+}
+
+static double seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static int evaluate_file(const char *path, int num_of_threads) {
+    FileStats stats;
+    double start = seconds();
+
+    if (!expr_evaluate_file(path, num_of_threads, STDOUT_FILENO, &stats)) return 1;
+
+    double elapsed = seconds() - start;
+    fprintf(
+        stderr, "[Info] : %ld lines in %.3f s, %.0f lines/s, %ld invalid, %ld divisions by zero\n",
+        stats.num_of_lines, elapsed, elapsed > 0 ? stats.num_of_lines / elapsed : 0.0,
+        stats.num_of_invalid, stats.num_of_divisions_by_zero
+    );
+    return stats.num_of_invalid > 0 ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = NULL;
+    int num_of_threads = 0;
+    bool is_repl = false;
+    const char *socket_path = NULL;
+    bool is_client = false;
+    size_t memory_budget = DEFAULT_CACHE_BUDGET;
+    int option;
+
+    while ((option = getopt(argc, argv, "e:f:j:rm:s:c:")) != -1) {
+        switch (option) {
+            case 'e' : return evaluate_bindings(optarg);
+            case 'f' : path = optarg; break;
+            case 'j' : num_of_threads = atoi(optarg); break;
+            case 'r' : is_repl = true; break;
+            case 'm' : memory_budget = parse_size(optarg); break;
+            case 's' : socket_path = optarg; break;
+            case 'c' : socket_path = optarg; is_client = true; break;
+            default  :
+                fprintf(
+                    stderr,
+                    "Usage: %s [-e expression < bindings | -f file [-j threads] | -r [-m memory] |\n"
+                    "       -s socket [-m memory] | -c socket]\n",
+                    argv[0]
+                );
+                return 1;
+        }
+    }
+    if (path != NULL) return evaluate_file(path, num_of_threads);
+    if (is_client) return expr_client(socket_path, STDIN_FILENO, STDOUT_FILENO) ? 0 : 1;
+    if (socket_path != NULL) return serve(socket_path, memory_budget);
+    if (is_repl) return evaluate_requests(memory_budget);
     char expression[100];
     printf("Enter an expression: ");
     scanf("%[^\n]", expression);
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../expr/cache.h"
+#include "../expr/program.h"
+
+// Compares compiling every expression again with taking it from the cache of
+// `expr/cache.h`, on requests where the same expressions come back with
+// other values:
+//
+//   bench/cache-bench [requests] [expressions] [memory]
+//
+//   [+] compile: `expr_compile`, `expr_optimize` and `expr_evaluate` for
+//                every request, which is what reading the text every time
+//                costs;
+//   [+] cache:   `expr_cache_get` and `expr_jit_evaluate`, with a cache of
+//                `memory` bytes.
+//
+// The requests pick among `expressions` generated expressions of the
+// variables a, b, c and d, the first ones much more often than the last
+// ones (the k-th about as often as 1/k). Both ways must give the same bits.
+
+#define DEFAULT_REQUESTS 1000000
+#define DEFAULT_EXPRESSIONS 1000
+#define DEFAULT_MEMORY (16 << 20)
+
+static unsigned long long state = 88172645463325252ULL;
+
+static unsigned long long next_random(void) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+static double seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static int write_expression(char *text, int depth) {
+    unsigned long long r = next_random();
+
+    if (depth == 0 || r % 5 == 0) {
+        if (r % 2 == 0) return sprintf(text, "%c", "abcd"[(r >> 8) % 4]);
+        return sprintf(text, "%llu.%llu", (r >> 8) % 100, (r >> 16) % 10);
+    }
+    int length = sprintf(text, "(");
+    length += write_expression(text + length, depth - 1);
+    length += sprintf(text + length, " %c ", "+-*/"[(r >> 24) % 4]);
+    length += write_expression(text + length, depth - 1);
+    return length + sprintf(text + length, ")");
+}
+
+int main(int argc, char *argv[]) {
+    long num_of_requests = argc > 1 ? atol(argv[1]) : DEFAULT_REQUESTS;
+    int num_of_expressions = argc > 2 ? atoi(argv[2]) : DEFAULT_EXPRESSIONS;
+    size_t memory = argc > 3 ? (size_t)atol(argv[3]) : DEFAULT_MEMORY;
+    if (num_of_expressions < 1) num_of_expressions = 1;
+
+    char (*expressions)[512] = malloc(num_of_expressions * sizeof(*expressions));
+    int *picks = malloc(num_of_requests * sizeof(int));
+    double *values = malloc(num_of_requests * 4 * sizeof(double));
+    double *results[2] = {
+        malloc(num_of_requests * sizeof(double)), malloc(num_of_requests * sizeof(double))
+    };
+    if (expressions == NULL || picks == NULL || values == NULL || results[0] == NULL || results[1] == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:main>\n");
+        return 1;
+    }
+
+    for (int e = 0; e < num_of_expressions; ++e) write_expression(expressions[e], 5);
+
+    // 1/k: the k-th expression is picked when a uniform number falls in its
+    // share of the harmonic sum.
+    double harmonic = 0;
+    for (int e = 1; e <= num_of_expressions; ++e) harmonic += 1.0 / e;
+    for (long r = 0; r < num_of_requests; ++r) {
+        double u = (next_random() >> 11) * 0x1.0p-53 * harmonic;
+        int e = 0;
+        while (e < num_of_expressions - 1 && (u -= 1.0 / (e + 1)) > 0) e++;
+        picks[r] = e;
+        for (int v = 0; v < 4; ++v) values[4 * r + v] = (long)(next_random() % 2001) / 100.0 - 10;
+    }
+
+    double start, compile_time, cache_time;
+    double ordered[4];
+    const char names[4][2] = { "a", "b", "c", "d" };
+
+    start = seconds();
+    for (long r = 0; r < num_of_requests; ++r) {
+        Program program;
+        if (!expr_compile(&program, expressions[picks[r]])) return 1;
+        expr_optimize(&program);
+        for (int v = 0; v < 4; ++v) {
+            int index = expr_variable(&program, names[v]);
+            if (index >= 0) ordered[index] = values[4 * r + v];
+        }
+        expr_evaluate(&program, ordered, &results[0][r]);
+        expr_free(&program);
+    }
+    compile_time = seconds() - start;
+
+    ExprCache cache;
+    expr_cache_init(&cache, memory);
+    start = seconds();
+    for (long r = 0; r < num_of_requests; ++r) {
+        const char *source = expressions[picks[r]];
+        const JitProgram *jit = expr_cache_get(&cache, source, strlen(source));
+        if (jit == NULL) return 1;
+        for (int v = 0; v < 4; ++v) {
+            int index = expr_variable(jit->program, names[v]);
+            if (index >= 0) ordered[index] = values[4 * r + v];
+        }
+        expr_jit_evaluate(jit, ordered, &results[1][r]);
+    }
+    cache_time = seconds() - start;
+
+    long different = 0;
+    for (long r = 0; r < num_of_requests; ++r) {
+        if (memcmp(&results[0][r], &results[1][r], sizeof(double)) != 0) different++;
+    }
+
+    printf("%ld requests of %d expressions, cache of %zu bytes\n", num_of_requests, num_of_expressions, memory);
+    printf("compile %8.3f s %8.2f M requests/s\n", compile_time, num_of_requests / compile_time / 1e6);
+    printf(
+        "cache   %8.3f s %8.2f M requests/s %6.1fx, %.1f%% hits, %ld evictions, %ld different\n",
+        cache_time, num_of_requests / cache_time / 1e6, compile_time / cache_time,
+        100.0 * cache.hits / num_of_requests, cache.evictions, different
+    );
+
+    expr_cache_free(&cache);
+    free(expressions);
+    free(picks);
+    free(values);
+    free(results[0]);
+    free(results[1]);
+    return different == 0 ? 0 : 1;
+}
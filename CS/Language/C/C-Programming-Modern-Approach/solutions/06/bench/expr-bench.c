@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../expr/columns.h"
+#include "../expr/program.h"
+
+// Compares the ways of evaluating one compiled expression for many rows:
+//
+//   bench/expr-bench [rows] [expression]
+//
+//   [+] rows:    `expr_evaluate` once per row, one instruction at a time;
+//   [+] columns: `expr_evaluate_columns`, one instruction for a block of rows
+//                (EXPR_KERNELS=scalar|sse2|avx2 chooses its kernels).
+//
+// The variables get deterministic pseudo-random values, a few of them zero
+// so that divisions by zero happen too, and both ways must give the same
+// bits for every row.
+
+#define DEFAULT_ROWS (1 << 22)
+#define DEFAULT_EXPRESSION "a * b + c * (d - 1.5) / (a + 10) - -b * (c - d) / 3"
+
+static unsigned long long state = 88172645463325252ULL;
+
+static double next_value(void) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    if (state % 64 == 0) return 0.0;
+    return (double)(state % 2000000) / 1000.0 - 1000.0;
+}
+
+static double seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    long num_of_rows = argc > 1 ? atol(argv[1]) : DEFAULT_ROWS;
+    const char *source = argc > 2 ? argv[2] : DEFAULT_EXPRESSION;
+    Program program;
+
+    if (!expr_compile(&program, source)) {
+        fprintf(stderr, "[Error] : %s\n", program.error);
+        return 1;
+    }
+
+    int num_of_variables = program.num_of_variables;
+    double **columns = malloc((num_of_variables + 1) * sizeof(double*));
+    double *by_rows = malloc(num_of_rows * sizeof(double));
+    double *by_columns = malloc(num_of_rows * sizeof(double));
+    double values[EXPR_MAX_STACK];
+    if (columns == NULL || by_rows == NULL || by_columns == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:main>\n");
+        return 1;
+    }
+    for (int v = 0; v < num_of_variables; ++v) {
+        columns[v] = malloc(num_of_rows * sizeof(double));
+        if (columns[v] == NULL) {
+            fprintf(stderr, "[Error] : malloc failed in <function:main>\n");
+            return 1;
+        }
+        for (long r = 0; r < num_of_rows; ++r) columns[v][r] = next_value();
+    }
+
+    printf("%ld rows of %s (%d instructions)\n", num_of_rows, source, program.length);
+
+    // Touch the results first, so that mapping their pages isn't timed.
+    memset(by_rows, 0, num_of_rows * sizeof(double));
+    memset(by_columns, 0, num_of_rows * sizeof(double));
+
+    double start = seconds();
+    for (long r = 0; r < num_of_rows; ++r) {
+        for (int v = 0; v < num_of_variables; ++v) values[v] = columns[v][r];
+        expr_evaluate(&program, values, &by_rows[r]);
+    }
+    double rows_time = seconds() - start;
+
+    start = seconds();
+    long zeros = expr_evaluate_columns(
+        &program, (const double* const*)columns, num_of_rows, by_columns, NULL
+    );
+    double columns_time = seconds() - start;
+
+    long different = 0;
+    for (long r = 0; r < num_of_rows; ++r) {
+        if (memcmp(&by_rows[r], &by_columns[r], sizeof(double)) != 0) different++;
+    }
+
+    printf("rows    %8.3f s %8.1f M rows/s\n", rows_time, num_of_rows / rows_time / 1e6);
+    printf("columns %8.3f s %8.1f M rows/s %6.1fx\n",
+        columns_time, num_of_rows / columns_time / 1e6, rows_time / columns_time);
+    printf("%ld rows with a division by zero, %ld different results\n", zeros, different);
+
+    for (int v = 0; v < num_of_variables; ++v) free(columns[v]);
+    free(columns);
+    free(by_rows);
+    free(by_columns);
+    expr_free(&program);
+    return different == 0 ? 0 : 1;
+}
@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../expr/jit.h"
+#include "../expr/program.h"
+
+// Compares three ways of evaluating one expression many times, one row of
+// values at a time:
+//
+//   bench/jit-bench [rows] [expression]
+//
+//   [+] tree:     a syntax tree of the expression, walked recursively;
+//   [+] bytecode: `expr_evaluate`, the postfix code of `program.h`;
+//   [+] jit:      `expr_jit_evaluate`, the machine code of `jit.h`.
+//
+// The variables get deterministic pseudo-random values, a few of them zero so
+// that divisions by zero happen too, and all three must give the same bits
+// and the same status for every row.
+
+#define DEFAULT_ROWS (1 << 22)
+#define DEFAULT_EXPRESSION "a * b + c * (d - 1.5) / (a + 10) - -b * (c - d) / 3"
+
+typedef struct Node {
+    Opcode op;
+    double value;           // ← The value of OP_CONST.
+    int variable;           // ← The index of OP_VAR.
+    struct Node *left, *right;
+} Node;
+
+static unsigned long long state = 88172645463325252ULL;
+
+static double next_value(void) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    if (state % 64 == 0) return 0.0;
+    return (double)(state % 2000000) / 1000.0 - 1000.0;
+}
+
+static double seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// Rebuilds the tree from the postfix code, the way a parser would have built
+// it: every operation takes the nodes on the top of the stack as children.
+
+static Node* build_tree(const Program *program, Node *nodes) {
+    Node *stack[EXPR_MAX_STACK];
+    Node *temporaries[EXPR_MAX_TEMPORARIES];
+    int top = -1;
+
+    for (int i = 0; i < program->length; ++i) {
+        Node *node = &nodes[i];
+
+        // A value kept by `expr_optimize` is a node with several parents.
+        if (program->code[i].op == OP_STORE) {
+            temporaries[program->code[i].operand] = stack[top];
+            continue;
+        }
+        if (program->code[i].op == OP_LOAD) {
+            stack[++top] = temporaries[program->code[i].operand];
+            continue;
+        }
+        node->op = program->code[i].op;
+        node->left = node->right = NULL;
+
+        switch (node->op) {
+            case OP_CONST : node->value = program->constants[program->code[i].operand]; break;
+            case OP_VAR   : node->variable = program->code[i].operand; break;
+            case OP_NEG   : node->left = stack[top--]; break;
+            default       :
+                node->right = stack[top--];
+                node->left = stack[top--];
+                break;
+        }
+        stack[++top] = node;
+    }
+    return stack[0];
+}
+
+static double walk(const Node *node, const double *values, ExprStatus *status) {
+    double left, right;
+
+    switch (node->op) {
+        case OP_CONST : return node->value;
+        case OP_VAR   : return values[node->variable];
+        case OP_NEG   : return -walk(node->left, values, status);
+        default       : break;
+    }
+
+    left = walk(node->left, values, status);
+    right = walk(node->right, values, status);
+    switch (node->op) {
+        case OP_ADD : return left + right;
+        case OP_SUB : return left - right;
+        case OP_MUL : return left * right;
+        default     :
+            if (right == 0.0) {
+                *status = EXPR_DIVISION_BY_ZERO;
+                return 0.0;
+            }
+            return left / right;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    long num_of_rows = argc > 1 ? atol(argv[1]) : DEFAULT_ROWS;
+    const char *source = argc > 2 ? argv[2] : DEFAULT_EXPRESSION;
+    Program program;
+    JitProgram jit;
+
+    if (!expr_compile(&program, source)) {
+        fprintf(stderr, "[Error] : %s\n", program.error);
+        return 1;
+    }
+    bool is_native = expr_jit_compile(&jit, &program);
+
+    int num_of_variables = program.num_of_variables > 0 ? program.num_of_variables : 1;
+    Node *nodes = malloc(program.length * sizeof(Node));
+    double *values = malloc(num_of_rows * num_of_variables * sizeof(double));
+    double *results[3];
+    unsigned char *statuses[3];
+    for (int k = 0; k < 3; ++k) {
+        results[k] = malloc(num_of_rows * sizeof(double));
+        statuses[k] = malloc(num_of_rows);
+        if (results[k] == NULL || statuses[k] == NULL) values = NULL;
+    }
+    if (nodes == NULL || values == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:main>\n");
+        return 1;
+    }
+    for (long i = 0; i < num_of_rows * num_of_variables; ++i) values[i] = next_value();
+
+    // Touch the results first, so that mapping their pages isn't timed.
+    for (int k = 0; k < 3; ++k) {
+        memset(results[k], 0, num_of_rows * sizeof(double));
+        memset(statuses[k], 0, num_of_rows);
+    }
+
+    const Node *root = build_tree(&program, nodes);
+    double times[3], start;
+
+    printf(
+        "%ld rows of %s (%d instructions, %s)\n", num_of_rows, source, program.length,
+        is_native ? "machine code" : "interpreted, no machine code"
+    );
+
+    start = seconds();
+    for (long r = 0; r < num_of_rows; ++r) {
+        ExprStatus status = EXPR_OK;
+        results[0][r] = walk(root, values + r * num_of_variables, &status);
+        statuses[0][r] = status;
+    }
+    times[0] = seconds() - start;
+
+    start = seconds();
+    for (long r = 0; r < num_of_rows; ++r)
+        statuses[1][r] = expr_evaluate(&program, values + r * num_of_variables, &results[1][r]);
+    times[1] = seconds() - start;
+
+    start = seconds();
+    for (long r = 0; r < num_of_rows; ++r)
+        statuses[2][r] = expr_jit_evaluate(&jit, values + r * num_of_variables, &results[2][r]);
+    times[2] = seconds() - start;
+
+    long different = 0, zeros = 0;
+    for (long r = 0; r < num_of_rows; ++r) {
+        for (int k = 1; k < 3; ++k) {
+            if (
+                memcmp(&results[0][r], &results[k][r], sizeof(double)) != 0 ||
+                statuses[0][r] != statuses[k][r]
+            ) {
+                different++;
+            }
+        }
+        zeros += statuses[2][r] == EXPR_DIVISION_BY_ZERO;
+    }
+
+    const char *names[3] = { "tree", "bytecode", "jit" };
+    for (int k = 0; k < 3; ++k) {
+        printf(
+            "%-8s %8.3f s %8.1f M rows/s %6.1fx\n", names[k], times[k],
+            num_of_rows / times[k] / 1e6, times[0] / times[k]
+        );
+    }
+    printf("%ld rows with a division by zero, %ld different results\n", zeros, different);
+
+    for (int k = 0; k < 3; ++k) {
+        free(results[k]);
+        free(statuses[k]);
+    }
+    free(values);
+    free(nodes);
+    expr_jit_free(&jit);
+    expr_free(&program);
+    return different == 0 ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../../common/number.h"
+
+// Compares ways of reading decimal numbers on a large corpus of them:
+//
+//   bench/number-bench [numbers | file]
+//
+//   [+] strtod: the C library;
+//   [+] number: `number_parse` of `common/number.h`;
+//   [+] scale:  the loop `parse_num` used to have, `num += digit * scale`
+//               with `scale *= 0.1` (and `has_met_dot` set to false).
+//
+// The corpus is the numbers of the file, separated by white space, or that
+// many generated numbers of every kind: integers, prices like 1234.56, the
+// shortest text of random doubles (up to 17 digits, with exponents) and
+// small fractions. Every number must give the same bits as `strtod`, which
+// is correctly rounded; the ones the old loop gets wrong are counted.
+
+#define DEFAULT_NUMBERS 2000000
+
+static unsigned long long state = 88172645463325252ULL;
+
+static unsigned long long next_random(void) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+static double seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static double scale_parse(const char *p, const char **end) {
+    double num = 0.0, scale = 1.0;
+    bool has_met_dot = false;
+
+    while ((*p >= '0' && *p <= '9') || *p == '.') {
+        if (*p == '.') {
+            has_met_dot = true;
+            p++;
+            continue;
+        }
+        if (has_met_dot) {
+            scale *= 0.1;
+            num += (*p - '0') * scale;
+        } else {
+            num = num * 10 + (*p - '0');
+        }
+        p++;
+    }
+    *end = p;
+    return num;
+}
+
+static char* generate(long count, size_t *length) {
+    size_t capacity = count * 32 + 1;
+    char *text = malloc(capacity);
+    size_t used = 0;
+
+    if (text == NULL) return NULL;
+    for (long i = 0; i < count; ++i) {
+        unsigned long long r = next_random();
+        double d;
+        switch (r % 4) {
+            case 0 : used += sprintf(text + used, "%llu\n", (r >> 8) % 100000000); break;
+            case 1 : used += sprintf(text + used, "%llu.%02llu\n", (r >> 8) % 100000, (r >> 40) % 100); break;
+            case 2 :
+                r = next_random();
+                memcpy(&d, &r, sizeof(d));
+                if (d != d || d - d != 0) d = 1.0 / 3;
+                used += sprintf(text + used, "%.17g\n", d < 0 ? -d : d);
+                break;
+            default : used += sprintf(text + used, "0.%06llu\n", (r >> 8) % 1000000); break;
+        }
+    }
+    *length = used;
+    return text;
+}
+
+static char* read_file(const char *name, size_t *length) {
+    FILE *file = fopen(name, "rb");
+    if (file == NULL) return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *text = malloc(size + 1);
+    if (text != NULL) {
+        *length = fread(text, 1, size, file);
+        text[*length] = '\0';
+    }
+    fclose(file);
+    return text;
+}
+
+int main(int argc, char *argv[]) {
+    size_t length = 0;
+    char *text;
+
+    if (argc > 1 && atol(argv[1]) == 0) {
+        text = read_file(argv[1], &length);
+    } else {
+        text = generate(argc > 1 ? atol(argv[1]) : DEFAULT_NUMBERS, &length);
+    }
+    if (text == NULL) {
+        fprintf(stderr, "[Error] : Can't read or make the corpus\n");
+        return 1;
+    }
+
+    // The start of every number, so that only the reading is timed.
+    long count = 0, capacity = length / 2 + 1;
+    const char **starts = malloc(capacity * sizeof(char*));
+    double *expected = malloc(capacity * sizeof(double));
+    double *values = malloc(capacity * sizeof(double));
+    if (starts == NULL || expected == NULL || values == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:main>\n");
+        return 1;
+    }
+    for (size_t i = 0; i < length; ) {
+        while (i < length && (text[i] == ' ' || text[i] == '\n' || text[i] == '\t' || text[i] == '\r')) i++;
+        if (i == length) break;
+        starts[count++] = text + i;
+        while (i < length && !(text[i] == ' ' || text[i] == '\n' || text[i] == '\t' || text[i] == '\r')) i++;
+    }
+    memset(expected, 0, count * sizeof(double));
+    memset(values, 0, count * sizeof(double));
+
+    const char *end = text + length;
+    double start, strtod_time, number_time, scale_time;
+    long different = 0, inexact = 0;
+
+    start = seconds();
+    for (long i = 0; i < count; ++i) expected[i] = strtod(starts[i], NULL);
+    strtod_time = seconds() - start;
+
+    start = seconds();
+    for (long i = 0; i < count; ++i) number_parse(starts[i], end, &values[i]);
+    number_time = seconds() - start;
+    for (long i = 0; i < count; ++i) {
+        if (memcmp(&values[i], &expected[i], sizeof(double)) != 0) different++;
+    }
+
+    start = seconds();
+    for (long i = 0; i < count; ++i) {
+        const char *stop;
+        values[i] = scale_parse(starts[i], &stop);
+    }
+    scale_time = seconds() - start;
+    for (long i = 0; i < count; ++i) {
+        if (memcmp(&values[i], &expected[i], sizeof(double)) != 0) inexact++;
+    }
+
+    printf("%ld numbers, %.1f MB\n", count, length / 1e6);
+    printf("strtod %8.3f s %8.1f MB/s %7.1f M numbers/s\n",
+        strtod_time, length / strtod_time / 1e6, count / strtod_time / 1e6);
+    printf("number %8.3f s %8.1f MB/s %7.1f M numbers/s %5.1fx, %ld different from strtod\n",
+        number_time, length / number_time / 1e6, count / number_time / 1e6,
+        strtod_time / number_time, different);
+    printf("scale  %8.3f s %8.1f MB/s %7.1f M numbers/s %5.1fx, %ld different from strtod\n",
+        scale_time, length / scale_time / 1e6, count / scale_time / 1e6,
+        strtod_time / scale_time, inexact);
+
+    free(text);
+    free(starts);
+    free(expected);
+    free(values);
+    return different == 0 ? 0 : 1;
+}
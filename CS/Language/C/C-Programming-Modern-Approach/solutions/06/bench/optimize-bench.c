@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../expr/columns.h"
+#include "../expr/jit.h"
+#include "../expr/program.h"
+
+// Compares an expression before and after `expr_optimize`, with each of the
+// ways to evaluate it:
+//
+//   bench/optimize-bench [rows] [expression]
+//
+//   [+] bytecode: `expr_evaluate` once per row;
+//   [+] columns:  `expr_evaluate_columns` for all the rows;
+//   [+] jit:      `expr_jit_evaluate` once per row.
+//
+// Every result of the optimized expression must have the same bits as the
+// bytecode of the original one, and the same divisions by zero.
+
+#define DEFAULT_ROWS (1 << 21)
+#define DEFAULT_EXPRESSION \
+    "(a * b + c) * (a * b + c) - (2 * 3 - 1) * d / (a * b + c) + (c - 0) * 1 - -(-(d / 4))"
+
+static unsigned long long state = 88172645463325252ULL;
+
+static double next_value(void) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    if (state % 64 == 0) return 0.0;
+    return (double)(state % 2000000) / 1000.0 - 1000.0;
+}
+
+static double seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void* allocate(size_t size) {
+    void *memory = malloc(size);
+    if (memory == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:allocate>\n");
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+// Times the three ways for one program. `results` gets the bytecode's
+// results, and every way is checked against `expected` (when given).
+
+static long run(
+    const char *label, const Program *program, double *const *columns, long num_of_rows,
+    double *results, unsigned char *zeros, const double *expected, const unsigned char *expected_zeros
+) {
+    JitProgram jit;
+    double values[EXPR_MAX_STACK];
+    double *other = allocate(num_of_rows * sizeof(double));
+    unsigned char *other_zeros = allocate(num_of_rows);
+    double times[3], start;
+    long different = 0;
+
+    memset(other, 0, num_of_rows * sizeof(double));
+    memset(other_zeros, 0, num_of_rows);
+    bool is_native = expr_jit_compile(&jit, program);
+    printf(
+        "%s: %d instructions, %d constants, %d temporaries, stack of %d%s\n", label,
+        program->length, program->num_of_constants, program->num_of_temporaries,
+        program->max_depth, is_native ? "" : " (no machine code)"
+    );
+
+    start = seconds();
+    for (long r = 0; r < num_of_rows; ++r) {
+        for (int v = 0; v < program->num_of_variables; ++v) values[v] = columns[v][r];
+        zeros[r] = expr_evaluate(program, values, &results[r]) == EXPR_DIVISION_BY_ZERO;
+    }
+    times[0] = seconds() - start;
+    if (expected == NULL) {
+        expected = results;
+        expected_zeros = zeros;
+    }
+    for (long r = 0; r < num_of_rows; ++r) {
+        if (memcmp(&results[r], &expected[r], sizeof(double)) != 0 || zeros[r] != expected_zeros[r])
+            different++;
+    }
+
+    start = seconds();
+    expr_evaluate_columns(program, (const double* const*)columns, num_of_rows, other, other_zeros);
+    times[1] = seconds() - start;
+    for (long r = 0; r < num_of_rows; ++r) {
+        if (memcmp(&other[r], &expected[r], sizeof(double)) != 0 || other_zeros[r] != expected_zeros[r])
+            different++;
+    }
+
+    start = seconds();
+    for (long r = 0; r < num_of_rows; ++r) {
+        for (int v = 0; v < program->num_of_variables; ++v) values[v] = columns[v][r];
+        other_zeros[r] = expr_jit_evaluate(&jit, values, &other[r]) == EXPR_DIVISION_BY_ZERO;
+    }
+    times[2] = seconds() - start;
+    for (long r = 0; r < num_of_rows; ++r) {
+        if (memcmp(&other[r], &expected[r], sizeof(double)) != 0 || other_zeros[r] != expected_zeros[r])
+            different++;
+    }
+
+    printf(
+        "  bytecode %7.1f   columns %7.1f   jit %7.1f   M rows/s\n",
+        num_of_rows / times[0] / 1e6, num_of_rows / times[1] / 1e6, num_of_rows / times[2] / 1e6
+    );
+
+    expr_jit_free(&jit);
+    free(other);
+    free(other_zeros);
+    return different;
+}
+
+int main(int argc, char *argv[]) {
+    long num_of_rows = argc > 1 ? atol(argv[1]) : DEFAULT_ROWS;
+    const char *source = argc > 2 ? argv[2] : DEFAULT_EXPRESSION;
+    Program original, optimized;
+
+    if (!expr_compile(&original, source) || !expr_compile(&optimized, source)) {
+        fprintf(stderr, "[Error] : %s\n", original.error);
+        return 1;
+    }
+    expr_optimize(&optimized);
+
+    int num_of_variables = original.num_of_variables;
+    double **columns = allocate((num_of_variables + 1) * sizeof(double*));
+    for (int v = 0; v < num_of_variables; ++v) {
+        columns[v] = allocate(num_of_rows * sizeof(double));
+        for (long r = 0; r < num_of_rows; ++r) columns[v][r] = next_value();
+    }
+    double *expected = allocate(num_of_rows * sizeof(double));
+    double *results = allocate(num_of_rows * sizeof(double));
+    unsigned char *expected_zeros = allocate(num_of_rows);
+    unsigned char *zeros = allocate(num_of_rows);
+    memset(results, 0, num_of_rows * sizeof(double));
+    memset(zeros, 0, num_of_rows);
+
+    printf("%ld rows of %s\n", num_of_rows, source);
+    long different = run("original ", &original, columns, num_of_rows, expected, expected_zeros, NULL, NULL);
+    different += run(
+        "optimized", &optimized, columns, num_of_rows, results, zeros, expected, expected_zeros
+    );
+    printf("%ld different results\n", different);
+
+    for (int v = 0; v < num_of_variables; ++v) free(columns[v]);
+    free(columns);
+    free(expected);
+    free(results);
+    free(expected_zeros);
+    free(zeros);
+    expr_free(&original);
+    expr_free(&optimized);
+    return different == 0 ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../expr/parallel.h"
+
+// Evaluates one file of expressions with more and more threads:
+//
+//   bench/parallel-bench [lines | file] [max threads]
+//
+// The file is the given one, or that many generated lines of expressions
+// like "12.5 * (3 - 7.25) / 7 + 4" (no number is 0, so divisions by zero are
+// rare), written to a temporary file. Every run writes its values to a
+// temporary file too, and they must be the same bytes as the values of the
+// run with one thread, in the same order. Threads are doubled from 1 up to
+// `max threads` (the number of processors by default).
+
+#define DEFAULT_LINES 4000000
+
+static unsigned long long state = 88172645463325252ULL;
+
+static unsigned long long next_random(void) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+static double seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void write_expression(FILE *file, int depth) {
+    unsigned long long r = next_random();
+
+    if (depth == 0 || r % 4 == 0) {
+        if (r % 3 == 0) {
+            fprintf(file, "%llu", (r >> 8) % 999 + 1);
+        } else {
+            fprintf(file, "%llu.%02llu", (r >> 8) % 999 + 1, (r >> 20) % 100);
+        }
+        return;
+    }
+    if (r % 7 == 1) {
+        fputs("(", file);
+        write_expression(file, depth - 1);
+        fputs(")", file);
+        return;
+    }
+    write_expression(file, depth - 1);
+    fprintf(file, " %c ", "+-*/"[(r >> 12) % 4]);
+    write_expression(file, depth - 1);
+}
+
+// Reads a whole file, to compare the values of two runs.
+
+static char* read_file(const char *name, long *length) {
+    FILE *file = fopen(name, "rb");
+    if (file == NULL) return NULL;
+
+    fseek(file, 0, SEEK_END);
+    *length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *text = malloc(*length + 1);
+    if (text != NULL) *length = fread(text, 1, *length, file);
+    fclose(file);
+    return text;
+}
+
+int main(int argc, char *argv[]) {
+    char input[] = "/tmp/parallel-bench-input-XXXXXX";
+    char output[] = "/tmp/parallel-bench-output-XXXXXX";
+    const char *path = input;
+    bool generated = !(argc > 1 && atol(argv[1]) == 0);
+    int max_threads = argc > 2 ? atoi(argv[2]) : sysconf(_SC_NPROCESSORS_ONLN);
+    if (max_threads < 1) max_threads = 1;
+
+    if (generated) {
+        long lines = argc > 1 ? atol(argv[1]) : DEFAULT_LINES;
+        int fd = mkstemp(input);
+        FILE *file = fd >= 0 ? fdopen(fd, "w") : NULL;
+        if (file == NULL) {
+            fprintf(stderr, "[Error] : Can't write the expressions\n");
+            return 1;
+        }
+        for (long i = 0; i < lines; ++i) {
+            write_expression(file, 4);
+            fputc('\n', file);
+        }
+        fclose(file);
+    } else {
+        path = argv[1];
+    }
+
+    int out = mkstemp(output);
+    if (out < 0) {
+        fprintf(stderr, "[Error] : Can't write the values\n");
+        return 1;
+    }
+
+    char *expected = NULL;
+    long expected_length = 0;
+    double one_thread_time = 0;
+    int status = 0;
+
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        FileStats stats;
+
+        if (ftruncate(out, 0) < 0 || lseek(out, 0, SEEK_SET) < 0) return 1;
+        double start = seconds();
+        if (!expr_evaluate_file(path, threads, out, &stats)) return 1;
+        double time = seconds() - start;
+
+        long length = 0;
+        char *values = read_file(output, &length);
+        bool same = true;
+        if (threads == 1) {
+            expected = values;
+            expected_length = length;
+            one_thread_time = time;
+        } else {
+            same = values != NULL && length == expected_length && memcmp(values, expected, length) == 0;
+            free(values);
+        }
+        if (!same) status = 1;
+
+        printf(
+            "%3d threads %8.3f s %8.2f M lines/s %5.2fx%s\n",
+            threads, time, stats.num_of_lines / time / 1e6, one_thread_time / time,
+            same ? "" : "   different values!"
+        );
+    }
+
+    free(expected);
+    close(out);
+    unlink(output);
+    if (generated) unlink(input);
+    return status;
+}
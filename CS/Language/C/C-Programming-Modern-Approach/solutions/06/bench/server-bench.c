@@ -0,0 +1,207 @@
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "../expr/program.h"
+#include "../expr/server.h"
+
+// Measures what a value costs from the daemon of `expr/server.h`, started in
+// a child process on a socket in /tmp, and from a new process:
+//
+//   bench/server-bench [requests] [program]
+//
+//   [+] round trip: one request at a time on one connection, each sent
+//                   once the answer of the previous one is back;
+//   [+] pipelined:  CLIENTS connections sending WINDOW requests each before
+//                   reading their answers, so the daemon gets batches;
+//   [+] process:    `program -e` (08-evaluate-expression by default) started
+//                   for every value, as a shell script would.
+//
+// Every answer of the daemon must be the value `expr_evaluate` gives.
+
+#define DEFAULT_REQUESTS 200000
+#define DEFAULT_PROGRAM "./08-evaluate-expression"
+#define EXPRESSION "x * (y + 1) - x / 3"
+#define CLIENTS 8
+#define WINDOW 256
+#define PROCESSES 200
+
+extern char **environ;
+
+static double seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static int connect_to(const char *path) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    strcpy(address.sun_path, path);
+
+    for (int attempt = 0; attempt < 200; ++attempt) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr*)&address, sizeof(address)) == 0) return fd;
+        if (fd >= 0) close(fd);
+        usleep(10000);     // ← The daemon may not listen yet.
+    }
+    return -1;
+}
+
+static bool write_all(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written <= 0) return false;
+        data += written;
+        length -= written;
+    }
+    return true;
+}
+
+// Reads `count` lines of answers into `answers`, returns where they end.
+
+static char* read_answers(int fd, char *answers, size_t capacity, int count) {
+    char *end = answers;
+
+    while (count > 0) {
+        ssize_t length = read(fd, end, answers + capacity - end);
+        if (length <= 0) return NULL;
+        for (ssize_t i = 0; i < length; ++i) count -= end[i] == '\n';
+        end += length;
+    }
+    return end;
+}
+
+static double expected_value(const Program *program, long r) {
+    double values[2], result;
+    values[expr_variable(program, "x")] = r % 1000;
+    values[expr_variable(program, "y")] = r % 7 - 3;
+    expr_evaluate(program, values, &result);
+    return result;
+}
+
+static int write_request(char *text, long r) {
+    return sprintf(text, "%s; x = %ld, y = %ld\n", EXPRESSION, r % 1000, r % 7 - 3);
+}
+
+static long check_answers(const Program *program, const char *answers, long first, int count) {
+    long wrong = 0;
+
+    for (int i = 0; i < count; ++i) {
+        char *end;
+        double value = strtod(answers, &end);
+        if (value != expected_value(program, first + i)) wrong++;
+        answers = end + 1;
+    }
+    return wrong;
+}
+
+int main(int argc, char *argv[]) {
+    long num_of_requests = argc > 1 ? atol(argv[1]) : DEFAULT_REQUESTS;
+    const char *program_path = argc > 2 ? argv[2] : DEFAULT_PROGRAM;
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/server-bench-%d.sock", (int)getpid());
+
+    Program program;
+    if (!expr_compile(&program, EXPRESSION)) return 1;
+
+    pid_t server = fork();
+    if (server == 0) {
+        ServerStats stats;
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDERR_FILENO);
+        exit(expr_serve(path, 16 << 20, &stats) ? 0 : 1);
+    }
+
+    char request[128], answers[WINDOW * 32 + 64];
+    long wrong = 0;
+    double start, round_trip_time, pipelined_time;
+
+    int fd = connect_to(path);
+    if (fd < 0) {
+        fprintf(stderr, "[Error] : Can't connect to the daemon\n");
+        kill(server, SIGTERM);
+        return 1;
+    }
+    start = seconds();
+    for (long r = 0; r < num_of_requests; ++r) {
+        int length = write_request(request, r);
+        if (!write_all(fd, request, length) || read_answers(fd, answers, sizeof(answers), 1) == NULL) {
+            fprintf(stderr, "[Error] : The connection failed\n");
+            return 1;
+        }
+        wrong += check_answers(&program, answers, r, 1);
+    }
+    round_trip_time = seconds() - start;
+    close(fd);
+
+    int fds[CLIENTS];
+    for (int c = 0; c < CLIENTS; ++c) fds[c] = connect_to(path);
+    long rounds = num_of_requests / (CLIENTS * WINDOW);
+    char *window = malloc(WINDOW * sizeof(request));
+    if (window == NULL) return 1;
+    start = seconds();
+    for (long round = 0; round < rounds; ++round) {
+        long first = round * WINDOW;
+        int length = 0;
+        for (int i = 0; i < WINDOW; ++i) length += write_request(window + length, first + i);
+        for (int c = 0; c < CLIENTS; ++c) {
+            if (!write_all(fds[c], window, length)) return 1;
+        }
+        for (int c = 0; c < CLIENTS; ++c) {
+            if (read_answers(fds[c], answers, sizeof(answers), WINDOW) == NULL) return 1;
+            wrong += check_answers(&program, answers, first, WINDOW);
+        }
+    }
+    pipelined_time = seconds() - start;
+    for (int c = 0; c < CLIENTS; ++c) close(fds[c]);
+    free(window);
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+
+    printf("round trip %8.3f s %8.1f us per request\n", round_trip_time, round_trip_time / num_of_requests * 1e6);
+    printf(
+        "pipelined  %8.3f s %8.1f us per request, %d clients of %d requests at once\n",
+        pipelined_time, pipelined_time / (rounds * CLIENTS * WINDOW) * 1e6, CLIENTS, WINDOW
+    );
+
+    // The bindings of `-e` come from a file, the value goes to /dev/null.
+    char bindings[] = "/tmp/server-bench-bindings-XXXXXX";
+    int bindings_fd = mkstemp(bindings);
+    if (bindings_fd >= 0 && access(program_path, X_OK) == 0) {
+        write_all(bindings_fd, "x, y\n1, 2\n", 10);
+        close(bindings_fd);
+
+        char *spawn_argv[] = { (char*)program_path, "-e", EXPRESSION, NULL };
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, bindings, O_RDONLY, 0);
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+        start = seconds();
+        for (int p = 0; p < PROCESSES; ++p) {
+            pid_t child;
+            if (posix_spawn(&child, program_path, &actions, NULL, spawn_argv, environ) != 0) break;
+            waitpid(child, NULL, 0);
+        }
+        double process_time = (seconds() - start) / PROCESSES;
+        posix_spawn_file_actions_destroy(&actions);
+        printf(
+            "process    %8.3f s %8.1f us per request, %.0fx the round trip\n",
+            process_time * PROCESSES, process_time * 1e6, process_time / (round_trip_time / num_of_requests)
+        );
+    } else {
+        printf("process    (no %s to start)\n", program_path);
+    }
+    if (bindings_fd >= 0) unlink(bindings);
+
+    printf("%ld wrong answers\n", wrong);
+    expr_free(&program);
+    return wrong == 0 ? 0 : 1;
+}
@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../../common/stack.h"
+
+// Compares the linked stack the solutions used to have (a `malloc` for every
+// push and a `free` for every pop) with the stack of `common/stack.h`:
+//
+//   bench/stack-bench [operations] [depth]
+//
+//   [+] linked:  the old StackNode list;
+//   [+] inline:  a stack whose inline buffer holds all `depth` items;
+//   [+] growing: a stack with 8 inline items that grows on the heap;
+//   [+] arena:   the same with the larger arrays taken from an arena.
+//
+// Each round pushes `depth` numbers and pops them all again, the way an
+// expression is evaluated, until `operations` pushes and pops are done. The
+// growing and arena stacks start again from their inline buffer every round,
+// so their growth is timed too.
+
+#define DEFAULT_OPERATIONS 100000000L
+#define DEFAULT_DEPTH 16
+#define ARENA_SIZE (1 << 20)
+
+typedef struct StackNode {
+    double num;
+    struct StackNode *next;
+} StackNode;
+
+typedef struct {
+    StackNode *top;
+} LinkedStack;
+
+static void linked_push(LinkedStack *stack, double num) {
+    StackNode *node = (StackNode*)malloc(sizeof(StackNode));
+    if (node == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:linked_push>\n");
+        exit(EXIT_FAILURE);
+    }
+    node->num = num;
+    node->next = stack->top;
+    stack->top = node;
+}
+
+static double linked_pop(LinkedStack *stack) {
+    StackNode *node = stack->top;
+    double num = node->num;
+    stack->top = node->next;
+    free(node);
+    return num;
+}
+
+STACK_DEFINE(WideStack, wide_stack, double, 4096)
+STACK_DEFINE(SmallStack, small_stack, double, 8)
+
+static double seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void report(const char *name, double time, long operations, double sum, double baseline) {
+    printf(
+        "%-8s %8.3f s %8.1f M ops/s %6.1fx   (sum %.0f)\n",
+        name, time, operations / time / 1e6, baseline / time, sum
+    );
+}
+
+int main(int argc, char *argv[]) {
+    long operations = argc > 1 ? atol(argv[1]) : DEFAULT_OPERATIONS;
+    int depth = argc > 2 ? atoi(argv[2]) : DEFAULT_DEPTH;
+    if (depth < 1) depth = 1;
+    if (depth > 4096) depth = 4096;
+    long rounds = operations / (2L * depth);
+    double start, linked_time, time, sum;
+
+    printf("%ld rounds of %d pushes and %d pops\n", rounds, depth, depth);
+
+    LinkedStack linked = { .top = NULL };
+    sum = 0;
+    start = seconds();
+    for (long r = 0; r < rounds; ++r) {
+        for (int i = 0; i < depth; ++i) linked_push(&linked, i + r);
+        for (int i = 0; i < depth; ++i) sum += linked_pop(&linked);
+    }
+    linked_time = seconds() - start;
+    report("linked", linked_time, 2 * rounds * depth, sum, linked_time);
+
+    WideStack *wide = malloc(sizeof(WideStack));
+    if (wide == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:main>\n");
+        return 1;
+    }
+    wide_stack_init(wide);
+    sum = 0;
+    start = seconds();
+    for (long r = 0; r < rounds; ++r) {
+        for (int i = 0; i < depth; ++i) wide_stack_push(wide, i + r);
+        for (int i = 0; i < depth; ++i) sum += wide_stack_pop(wide);
+    }
+    time = seconds() - start;
+    report("inline", time, 2 * rounds * depth, sum, linked_time);
+    wide_stack_free(wide);
+    free(wide);
+
+    SmallStack small;
+    sum = 0;
+    start = seconds();
+    for (long r = 0; r < rounds; ++r) {
+        small_stack_init(&small);
+        for (int i = 0; i < depth; ++i) small_stack_push(&small, i + r);
+        for (int i = 0; i < depth; ++i) sum += small_stack_pop(&small);
+        small_stack_free(&small);
+    }
+    time = seconds() - start;
+    report("growing", time, 2 * rounds * depth, sum, linked_time);
+
+    char *memory = malloc(ARENA_SIZE);
+    Arena arena;
+    if (memory == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:main>\n");
+        return 1;
+    }
+    arena_init(&arena, memory, ARENA_SIZE);
+    sum = 0;
+    start = seconds();
+    for (long r = 0; r < rounds; ++r) {
+        small_stack_init_arena(&small, &arena);
+        for (int i = 0; i < depth; ++i) small_stack_push(&small, i + r);
+        for (int i = 0; i < depth; ++i) sum += small_stack_pop(&small);
+        small_stack_free(&small);
+        arena_reset(&arena);
+    }
+    time = seconds() - start;
+    report("arena", time, 2 * rounds * depth, sum, linked_time);
+    free(memory);
+    return 0;
+}
@@ -0,0 +1,220 @@
+#include "cache.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void* allocate(size_t size) {
+    void *memory = calloc(1, size);
+    if (memory == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:expr_cache_get>\n");
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+void expr_cache_init(ExprCache *cache, size_t memory_budget) {
+    memset(cache, 0, sizeof(ExprCache));
+    cache->memory_budget = memory_budget;
+    cache->num_of_buckets = 64;
+    cache->buckets = allocate(cache->num_of_buckets * sizeof(CacheEntry*));
+}
+
+static bool is_word(char ch) {
+    return (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'z') ||
+           (ch >= 'A' && ch <= 'Z') || ch == '_' || ch == '.';
+}
+
+// Drops the spaces of `source`, except one where two numbers or names would
+// be joined ("1 2", which isn't 12) or where a sign and its digits would
+// become the exponent of a number ("1e -5" and "1e- 5", which aren't 1e-5
+// and aren't valid). The normalized text is what's compiled, so it has to
+// mean the same as `source`. Returns the length.
+
+static size_t normalize(ExprCache *cache, const char *source, size_t length) {
+    if (cache->normalized_capacity < length + 1) {
+        cache->normalized_capacity = 2 * (length + 1);
+        free(cache->normalized);
+        cache->normalized = allocate(cache->normalized_capacity);
+    }
+
+    char *out = cache->normalized;
+    size_t used = 0;
+    bool has_space = false;
+    for (size_t i = 0; i < length; ++i) {
+        char ch = source[i];
+
+        if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n') {
+            has_space = true;
+            continue;
+        }
+        if (has_space && used > 0) {
+            char last = out[used - 1];
+            bool is_sign = last == '+' || last == '-';
+            char before = used > 1 ? out[used - 2] : '\0';
+            if (
+                (is_word(last) && is_word(ch)) ||
+                ((last == 'e' || last == 'E') && (ch == '+' || ch == '-')) ||
+                (is_sign && (before == 'e' || before == 'E') && is_word(ch))
+            ) {
+                out[used++] = ' ';
+            }
+        }
+        out[used++] = ch;
+        has_space = false;
+    }
+    out[used] = '\0';
+    return used;
+}
+
+// A 64-bit hash of the text, mixing in eight characters at a time.
+
+static uint64_t hash_text(const char *text, size_t length) {
+    uint64_t hash = 0x9E3779B97F4A7C15ULL ^ length;
+
+    while (length >= 8) {
+        uint64_t word;
+        memcpy(&word, text, sizeof(word));
+        hash = (hash ^ word) * 0xBF58476D1CE4E5B9ULL;
+        hash ^= hash >> 31;
+        text += 8;
+        length -= 8;
+    }
+    uint64_t word = 0;
+    memcpy(&word, text, length);
+    hash = (hash ^ word) * 0x94D049BB133111EBULL;
+    hash ^= hash >> 29;
+    return hash;
+}
+
+static void unlink_entry(ExprCache *cache, CacheEntry *entry) {
+    if (entry->newer != NULL) {
+        entry->newer->older = entry->older;
+    } else {
+        cache->newest = entry->older;
+    }
+    if (entry->older != NULL) {
+        entry->older->newer = entry->newer;
+    } else {
+        cache->oldest = entry->newer;
+    }
+    entry->newer = entry->older = NULL;
+}
+
+static void make_newest(ExprCache *cache, CacheEntry *entry) {
+    entry->older = cache->newest;
+    entry->newer = NULL;
+    if (cache->newest != NULL) cache->newest->newer = entry;
+    cache->newest = entry;
+    if (cache->oldest == NULL) cache->oldest = entry;
+}
+
+static void free_entry(CacheEntry *entry) {
+    expr_jit_free(&entry->jit);
+    expr_free(&entry->program);
+    free(entry->source);
+    free(entry);
+}
+
+static void evict_oldest(ExprCache *cache) {
+    CacheEntry *entry = cache->oldest;
+    CacheEntry **link = &cache->buckets[entry->hash & (cache->num_of_buckets - 1)];
+
+    while (*link != entry) link = &(*link)->next;
+    *link = entry->next;
+    unlink_entry(cache, entry);
+    cache->memory_used -= entry->size;
+    cache->num_of_entries--;
+    cache->evictions++;
+    free_entry(entry);
+}
+
+// Drops the least recently used entries, but not `entry`, until the others
+// fit in the budget.
+
+static void fit_budget(ExprCache *cache, const CacheEntry *entry) {
+    while (cache->memory_used > cache->memory_budget && cache->oldest != entry)
+        evict_oldest(cache);
+}
+
+// Doubles the buckets once there are more entries than buckets.
+
+static void grow_buckets(ExprCache *cache) {
+    size_t num_of_buckets = 2 * cache->num_of_buckets;
+    CacheEntry **buckets = allocate(num_of_buckets * sizeof(CacheEntry*));
+
+    for (size_t b = 0; b < cache->num_of_buckets; ++b) {
+        CacheEntry *entry = cache->buckets[b];
+        while (entry != NULL) {
+            CacheEntry *next = entry->next;
+            CacheEntry **bucket = &buckets[entry->hash & (num_of_buckets - 1)];
+            entry->next = *bucket;
+            *bucket = entry;
+            entry = next;
+        }
+    }
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->num_of_buckets = num_of_buckets;
+}
+
+const JitProgram* expr_cache_get(ExprCache *cache, const char *source, size_t length) {
+    length = normalize(cache, source, length);
+    uint64_t hash = hash_text(cache->normalized, length);
+
+    for (
+        CacheEntry *entry = cache->buckets[hash & (cache->num_of_buckets - 1)];
+        entry != NULL; entry = entry->next
+    ) {
+        if (entry->hash == hash && strcmp(entry->source, cache->normalized) == 0) {
+            cache->hits++;
+            unlink_entry(cache, entry);
+            make_newest(cache, entry);
+            if (++entry->uses == EXPR_CACHE_JIT_USES && expr_jit_compile(&entry->jit, &entry->program)) {
+                entry->size += entry->jit.size;
+                cache->memory_used += entry->jit.size;
+                fit_budget(cache, entry);
+            }
+            return &entry->jit;
+        }
+    }
+
+    cache->misses++;
+    CacheEntry *entry = allocate(sizeof(CacheEntry));
+    if (!expr_compile(&entry->program, cache->normalized)) {
+        snprintf(cache->error, sizeof(cache->error), "%s", entry->program.error);
+        expr_free(&entry->program);
+        free(entry);
+        return NULL;
+    }
+    expr_optimize(&entry->program);
+    entry->jit.program = &entry->program;
+
+    entry->hash = hash;
+    entry->source = allocate(length + 1);
+    memcpy(entry->source, cache->normalized, length + 1);
+    entry->size =
+        sizeof(CacheEntry) + length + 1 +
+        entry->program.length * sizeof(Instruction) +
+        entry->program.num_of_constants * sizeof(double) +
+        entry->program.num_of_variables * EXPR_MAX_NAME;
+
+    if (cache->num_of_entries >= (long)cache->num_of_buckets) grow_buckets(cache);
+    CacheEntry **bucket = &cache->buckets[hash & (cache->num_of_buckets - 1)];
+    entry->next = *bucket;
+    *bucket = entry;
+    make_newest(cache, entry);
+    cache->num_of_entries++;
+    cache->memory_used += entry->size;
+
+    fit_budget(cache, entry);
+    return &entry->jit;
+}
+
+void expr_cache_free(ExprCache *cache) {
+    while (cache->oldest != NULL) evict_oldest(cache);
+    free(cache->buckets);
+    free(cache->normalized);
+    cache->buckets = NULL;
+    cache->normalized = NULL;
+}
@@ -0,0 +1,80 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "jit.h"
+#include "program.h"
+
+// Keeps the expressions compiled most recently, so that an expression that
+// comes back (with other values of its variables) isn't read, optimized and
+// translated into machine code again. An expression is looked up by its
+// normalized text, without the spaces that don't separate anything, so
+// "x*(y+1)" and "x * (y + 1)" are the same entry:
+//
+//   [+] The entries are in a hash table, under a 64-bit hash of that text
+//       computed eight bytes at a time;
+//   [+] They're also in a list from the most to the least recently used
+//       one. When the memory of the entries (their text, their code and
+//       their machine code) goes over the budget, the least recently used
+//       ones are dropped until it fits again;
+//   [+] An expression is interpreted by `expr_evaluate` until it has been
+//       taken from the cache EXPR_CACHE_JIT_USES times, and only then
+//       translated into machine code (see `jit.h`). That takes a few system
+//       calls, which only pay off for an expression evaluated many times.
+
+#define EXPR_CACHE_JIT_USES 32
+
+typedef struct CacheEntry {
+    uint64_t hash;
+    char *source;                   // ← The normalized text.
+    size_t size;                    // ← The memory the entry holds.
+    long uses;
+    Program program;
+    JitProgram jit;
+    struct CacheEntry *next;        // ← The next entry of the same bucket.
+    struct CacheEntry *newer;
+    struct CacheEntry *older;
+} CacheEntry;
+
+typedef struct {
+    CacheEntry **buckets;
+    size_t num_of_buckets;
+    CacheEntry *newest;
+    CacheEntry *oldest;
+    long num_of_entries;
+
+    size_t memory_used;
+    size_t memory_budget;
+    long hits;
+    long misses;
+    long evictions;
+
+    char *normalized;               // ← Where a text is normalized before it's looked up.
+    size_t normalized_capacity;
+    char error[80];                 // ← Why the last expression couldn't be compiled.
+} ExprCache;
+
+/*!
+ * @param [out] [cache] An empty cache.
+ * @param [in] [memory_budget] The most bytes the entries may hold. The last
+ * entry is kept even if it holds more alone.
+ */
+void expr_cache_init(ExprCache *cache, size_t memory_budget);
+
+/*!
+ * @remark Releases every entry of the cache.
+ */
+void expr_cache_free(ExprCache *cache);
+
+/*!
+ * @param [in] [source] The text of an expression, `length` characters long
+ * (it doesn't need to end with '\0').
+ * @remark Returns the compiled and optimized expression, from the cache if
+ * it's there (a hit) and compiled now otherwise (a miss), which stays valid
+ * until the next call. Returns NULL and describes the problem in
+ * `cache->error` if the expression isn't valid; those aren't kept.
+ */
+const JitProgram* expr_cache_get(ExprCache *cache, const char *source, size_t length);
+
+#endif
@@ -0,0 +1,244 @@
+#include "columns.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Every value on the stack is a block of rows. A variable doesn't need to be
+// copied: its block is just a pointer into its column. Nor does a constant:
+// a block of it is filled once for all the blocks of rows. An operation
+// writes its result over the block of its left operand's slot, and a value
+// kept with STORE is copied to a block of its temporary.
+//
+// The operations on blocks are done with AVX2 (4 rows per instruction) when
+// the processor supports it, with SSE2 (2 rows) otherwise on x86-64, and one
+// row at a time elsewhere. A division by zero is found for all the lanes at
+// once by comparing the divisors with zero: the quotient of those lanes is
+// replaced by 0 and their rows are marked.
+
+typedef void (*Kernel)(double *dst, const double *a, const double *b, int n);
+typedef int (*DivideKernel)(double *dst, const double *a, const double *b, int n, unsigned char *zero);
+
+static void add_scalar(double *dst, const double *a, const double *b, int n) {
+    for (int i = 0; i < n; ++i) dst[i] = a[i] + b[i];
+}
+
+static void sub_scalar(double *dst, const double *a, const double *b, int n) {
+    for (int i = 0; i < n; ++i) dst[i] = a[i] - b[i];
+}
+
+static void mul_scalar(double *dst, const double *a, const double *b, int n) {
+    for (int i = 0; i < n; ++i) dst[i] = a[i] * b[i];
+}
+
+static int div_scalar(double *dst, const double *a, const double *b, int n, unsigned char *zero) {
+    int count = 0;
+    for (int i = 0; i < n; ++i) {
+        if (b[i] == 0.0) {
+            dst[i] = 0.0;
+            zero[i] = 1;
+            count++;
+        } else {
+            dst[i] = a[i] / b[i];
+        }
+    }
+    return count;
+}
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+#define BINARY_SSE2(name, instruction)                                          \
+    static void name##_sse2(double *dst, const double *a, const double *b, int n) { \
+        int i = 0;                                                              \
+        for (; i + 2 <= n; i += 2)                                              \
+            _mm_storeu_pd(dst + i, instruction(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i))); \
+        name##_scalar(dst + i, a + i, b + i, n - i);                            \
+    }
+
+#define BINARY_AVX2(name, instruction)                                          \
+    __attribute__((target("avx2")))                                             \
+    static void name##_avx2(double *dst, const double *a, const double *b, int n) { \
+        int i = 0;                                                              \
+        for (; i + 4 <= n; i += 4)                                              \
+            _mm256_storeu_pd(dst + i, instruction(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i))); \
+        name##_scalar(dst + i, a + i, b + i, n - i);                            \
+    }
+
+BINARY_SSE2(add, _mm_add_pd)
+BINARY_SSE2(sub, _mm_sub_pd)
+BINARY_SSE2(mul, _mm_mul_pd)
+BINARY_AVX2(add, _mm256_add_pd)
+BINARY_AVX2(sub, _mm256_sub_pd)
+BINARY_AVX2(mul, _mm256_mul_pd)
+
+static int div_sse2(double *dst, const double *a, const double *b, int n, unsigned char *zero) {
+    int i = 0, count = 0;
+
+    for (; i + 2 <= n; i += 2) {
+        __m128d divisor = _mm_loadu_pd(b + i);
+        __m128d is_zero = _mm_cmpeq_pd(divisor, _mm_setzero_pd());
+        __m128d quotient = _mm_div_pd(_mm_loadu_pd(a + i), divisor);
+
+        _mm_storeu_pd(dst + i, _mm_andnot_pd(is_zero, quotient));
+        int mask = _mm_movemask_pd(is_zero);
+        if (mask != 0) {
+            zero[i] |= mask & 1;
+            zero[i + 1] |= mask >> 1;
+            count += __builtin_popcount(mask);
+        }
+    }
+    return count + div_scalar(dst + i, a + i, b + i, n - i, zero + i);
+}
+
+__attribute__((target("avx2")))
+static int div_avx2(double *dst, const double *a, const double *b, int n, unsigned char *zero) {
+    int i = 0, count = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m256d divisor = _mm256_loadu_pd(b + i);
+        __m256d is_zero = _mm256_cmp_pd(divisor, _mm256_setzero_pd(), _CMP_EQ_OQ);
+        __m256d quotient = _mm256_div_pd(_mm256_loadu_pd(a + i), divisor);
+
+        _mm256_storeu_pd(dst + i, _mm256_andnot_pd(is_zero, quotient));
+        int mask = _mm256_movemask_pd(is_zero);
+        if (mask != 0) {
+            for (int k = 0; k < 4; ++k) zero[i + k] |= (mask >> k) & 1;
+            count += __builtin_popcount(mask);
+        }
+    }
+    return count + div_scalar(dst + i, a + i, b + i, n - i, zero + i);
+}
+#endif
+
+static Kernel add_kernel = NULL, sub_kernel = NULL, mul_kernel = NULL;
+static DivideKernel div_kernel = NULL;
+
+// EXPR_KERNELS=scalar|sse2|avx2 forces a choice, to compare them.
+
+static void select_kernels(void) {
+    const char *forced = getenv("EXPR_KERNELS");
+
+    add_kernel = add_scalar;
+    sub_kernel = sub_scalar;
+    mul_kernel = mul_scalar;
+    div_kernel = div_scalar;
+    if (forced != NULL && strcmp(forced, "scalar") == 0) return;
+
+#if defined(__x86_64__)
+    add_kernel = add_sse2;
+    sub_kernel = sub_sse2;
+    mul_kernel = mul_sse2;
+    div_kernel = div_sse2;
+    if (forced != NULL && strcmp(forced, "sse2") == 0) return;
+
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        add_kernel = add_avx2;
+        sub_kernel = sub_avx2;
+        mul_kernel = mul_avx2;
+        div_kernel = div_avx2;
+    }
+#endif
+}
+
+static int evaluate_block(
+    const Program *program, const double *const *columns, const double *constants,
+    double *temporaries, long first, int n, double *results, unsigned char *zero
+) {
+    double blocks[program->max_depth > 0 ? program->max_depth : 1][EXPR_BLOCK_ROWS];
+    const double *stack[EXPR_MAX_STACK];
+    const Instruction *code = program->code;
+    int top = -1, count = 0;
+
+    for (int i = 0; i < program->length; ++i) {
+        switch (code[i].op) {
+            case OP_CONST :
+                stack[++top] = constants + (long)code[i].operand * EXPR_BLOCK_ROWS;
+                break;
+            case OP_VAR   :
+                stack[++top] = columns[code[i].operand] + first;
+                break;
+            case OP_NEG   :
+                for (int r = 0; r < n; ++r) blocks[top][r] = -stack[top][r];
+                stack[top] = blocks[top];
+                break;
+            case OP_STORE :
+                memcpy(temporaries + (long)code[i].operand * EXPR_BLOCK_ROWS, stack[top], n * sizeof(double));
+                break;
+            case OP_LOAD  :
+                stack[++top] = temporaries + (long)code[i].operand * EXPR_BLOCK_ROWS;
+                break;
+            default       : {
+                const double *a = stack[top - 1], *b = stack[top];
+                double *dst = blocks[--top];
+
+                // The last operation writes straight to the results.
+                if (i == program->length - 1) dst = results;
+
+                switch (code[i].op) {
+                    case OP_ADD : add_kernel(dst, a, b, n); break;
+                    case OP_SUB : sub_kernel(dst, a, b, n); break;
+                    case OP_MUL : mul_kernel(dst, a, b, n); break;
+                    default     : count += div_kernel(dst, a, b, n, zero); break;
+                }
+                stack[top] = dst;
+                break;
+            }
+        }
+    }
+
+    if (top != 0) {
+        memset(results, 0, n * sizeof(double));
+    } else if (stack[0] != results) {
+        memcpy(results, stack[0], n * sizeof(double));
+    }
+
+    // The kernels count divisions, and a row can have several of them.
+    if (count == 0) return 0;
+    int rows = 0;
+    for (int r = 0; r < n; ++r) rows += zero[r];
+    return rows;
+}
+
+long expr_evaluate_columns(
+    const Program *program, const double *const *columns, long num_of_rows,
+    double *results, unsigned char *division_by_zero
+) {
+    unsigned char zero[EXPR_BLOCK_ROWS];
+    bool has_division = false;
+    long count = 0;
+
+    if (add_kernel == NULL) select_kernels();
+    for (int i = 0; i < program->length; ++i) {
+        if (program->code[i].op == OP_DIV) has_division = true;
+    }
+    if (!has_division && division_by_zero != NULL) memset(division_by_zero, 0, num_of_rows);
+
+    // A block for each constant, then one for each temporary.
+    double *constants = NULL, *temporaries = NULL;
+    int num_of_blocks = program->num_of_constants + program->num_of_temporaries;
+    if (num_of_blocks > 0) {
+        constants = (double*)malloc((long)num_of_blocks * EXPR_BLOCK_ROWS * sizeof(double));
+        if (constants == NULL) {
+            fprintf(stderr, "[Error] : malloc failed in <function:expr_evaluate_columns>\n");
+            exit(EXIT_FAILURE);
+        }
+        for (int c = 0; c < program->num_of_constants; ++c) {
+            for (int r = 0; r < EXPR_BLOCK_ROWS; ++r)
+                constants[c * EXPR_BLOCK_ROWS + r] = program->constants[c];
+        }
+        temporaries = constants + (long)program->num_of_constants * EXPR_BLOCK_ROWS;
+    }
+
+    for (long first = 0; first < num_of_rows; first += EXPR_BLOCK_ROWS) {
+        int n = num_of_rows - first < EXPR_BLOCK_ROWS ? num_of_rows - first : EXPR_BLOCK_ROWS;
+        int block_count;
+
+        if (has_division) memset(zero, 0, n);
+        block_count = evaluate_block(program, columns, constants, temporaries, first, n, results + first, zero);
+        count += block_count;
+        if (has_division && division_by_zero != NULL) memcpy(division_by_zero + first, zero, n);
+    }
+    free(constants);
+    return count;
+}
@@ -0,0 +1,30 @@
+#ifndef COLUMNS_H
+#define COLUMNS_H
+
+#include "program.h"
+
+// Evaluates a compiled expression for many rows at once. Instead of running
+// the whole program for one row and then for the next, each instruction is
+// run for a block of EXPR_BLOCK_ROWS rows before the next instruction, so the
+// cost of decoding an instruction is shared by the whole block and the
+// arithmetic of neighbouring rows is done together with SIMD instructions.
+
+#define EXPR_BLOCK_ROWS 512
+
+/*!
+ * @param [in] [columns] columns[v] points to the `num_of_rows` values of the
+ * variable program->variables[v], one per row.
+ * @param [out] [results] The value of the expression for each row.
+ * @param [out] [division_by_zero] Set to 1 for each row where a division by
+ * zero happened (which gives 0, as in `expr_evaluate`) and 0 for the others,
+ * or NULL.
+ * @remark Returns the number of rows with a division by zero. Gives the same
+ * results as `expr_evaluate` for each row. The only memory allocated is a
+ * block of rows for each constant and temporary of the program.
+ */
+long expr_evaluate_columns(
+    const Program *program, const double *const *columns, long num_of_rows,
+    double *results, unsigned char *division_by_zero
+);
+
+#endif
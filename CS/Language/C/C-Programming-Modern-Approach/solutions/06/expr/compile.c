@@ -0,0 +1,226 @@
+#include "program.h"
+#include "../../common/number.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The same shunting-yard algorithm as `calculate_expression`, except that
+// when an operation is taken from the operation stack it's not computed but
+// written out as an instruction. Numbers and variables are written out as
+// soon as they're read, so the instructions come out in postfix order.
+//
+// A '-' where a number is expected (at the beginning, after '(' or after
+// another operation) is the negation of what follows. It's kept on the
+// operation stack as 'n', which binds more tightly than anything else.
+
+static void* grow(void *memory, int *capacity, int needed, size_t size) {
+    int larger = *capacity > 0 ? *capacity : 16;
+    while (larger < needed) larger *= 2;
+
+    memory = realloc(memory, larger * size);
+    if (memory == NULL) {
+        fprintf(stderr, "[Error] : realloc failed in <function:grow>\n");
+        exit(EXIT_FAILURE);
+    }
+    *capacity = larger;
+    return memory;
+}
+
+typedef struct {
+    Program *program;
+    int code_capacity;
+    int constants_capacity;
+    int variables_capacity;
+    int depth;
+} Compiler;
+
+static int get_priority(char op) {
+    switch (op) {
+        case '(' : return 0;
+        case '+' :
+        case '-' : return 1;
+        case '*' :
+        case '/' : return 2;
+        case 'n' : return 3;
+        default  : return -1;
+    }
+}
+
+static void emit(Compiler *compiler, Opcode op, int operand) {
+    Program *program = compiler->program;
+
+    // "-2" is the constant -2 rather than 2 and a negation.
+    if (
+        op == OP_NEG && program->length > 0 &&
+        program->code[program->length - 1].op == OP_CONST
+    ) {
+        int constant = program->code[program->length - 1].operand;
+        program->constants[constant] = -program->constants[constant];
+        return;
+    }
+
+    if (program->length == compiler->code_capacity)
+        program->code = grow(
+            program->code, &compiler->code_capacity, program->length + 1, sizeof(Instruction)
+        );
+    program->code[program->length].op = op;
+    program->code[program->length].operand = operand;
+    program->length++;
+
+    if (op == OP_CONST || op == OP_VAR) {
+        compiler->depth++;
+    } else if (op != OP_NEG) {
+        compiler->depth--;
+    }
+    if (compiler->depth > program->max_depth) program->max_depth = compiler->depth;
+}
+
+static void emit_operation(Compiler *compiler, char op) {
+    switch (op) {
+        case '+' : emit(compiler, OP_ADD, 0); break;
+        case '-' : emit(compiler, OP_SUB, 0); break;
+        case '*' : emit(compiler, OP_MUL, 0); break;
+        case '/' : emit(compiler, OP_DIV, 0); break;
+        case 'n' : emit(compiler, OP_NEG, 0); break;
+    }
+}
+
+static void emit_constant(Compiler *compiler, double value) {
+    Program *program = compiler->program;
+
+    if (program->num_of_constants == compiler->constants_capacity)
+        program->constants = grow(
+            program->constants, &compiler->constants_capacity,
+            program->num_of_constants + 1, sizeof(double)
+        );
+    program->constants[program->num_of_constants] = value;
+    emit(compiler, OP_CONST, program->num_of_constants++);
+}
+
+static void emit_variable(Compiler *compiler, const char *name) {
+    Program *program = compiler->program;
+    int index = expr_variable(program, name);
+
+    if (index < 0) {
+        if (program->num_of_variables == compiler->variables_capacity)
+            program->variables = grow(
+                program->variables, &compiler->variables_capacity,
+                program->num_of_variables + 1, EXPR_MAX_NAME
+            );
+        index = program->num_of_variables++;
+        strcpy(program->variables[index], name);
+    }
+    emit(compiler, OP_VAR, index);
+}
+
+static bool fail(Program *program, const char *message, char ch) {
+    if (ch != '\0') {
+        snprintf(program->error, sizeof(program->error), "%s %c", message, ch);
+    } else {
+        snprintf(program->error, sizeof(program->error), "%s", message);
+    }
+    return false;
+}
+
+static bool compile(Compiler *compiler, const char *expr, char *op_stack) {
+    Program *program = compiler->program;
+    const char *expr_end = expr + strlen(expr);
+    int num_of_ops = 0;
+    bool expect_operand = true;
+    int i = 0;
+
+    while (expr[i] != '\0') {
+        char ch = expr[i];
+
+        if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r') {
+            i++;
+            continue;
+        }
+
+        if (expect_operand) {
+            if (isdigit((unsigned char)ch) || ch == '.') {
+                double num;
+                const char *end = number_parse(expr + i, expr_end, &num);
+
+                if (end == expr + i) return fail(program, "Invalid number at", ch);
+                emit_constant(compiler, num);
+                i = end - expr;
+                expect_operand = false;
+            } else if (isalpha((unsigned char)ch) || ch == '_') {
+                char name[EXPR_MAX_NAME];
+                int length = 0;
+
+                while (isalnum((unsigned char)expr[i]) || expr[i] == '_') {
+                    if (length == EXPR_MAX_NAME - 1) return fail(program, "Too long name of a variable", '\0');
+                    name[length++] = expr[i++];
+                }
+                name[length] = '\0';
+                emit_variable(compiler, name);
+                expect_operand = false;
+            } else if (ch == '(') {
+                op_stack[num_of_ops++] = '(';
+                i++;
+            } else if (ch == '-') {
+                op_stack[num_of_ops++] = 'n';
+                i++;
+            } else {
+                return fail(program, "Expected a number, a variable or ( instead of", ch);
+            }
+        } else if (ch == ')') {
+            while (num_of_ops > 0 && op_stack[num_of_ops - 1] != '(')
+                emit_operation(compiler, op_stack[--num_of_ops]);
+            if (num_of_ops == 0) return fail(program, "Lack left parenthesis", '\0');
+            num_of_ops--;
+            i++;
+        } else if (ch == '+' || ch == '-' || ch == '*' || ch == '/') {
+            while (num_of_ops > 0 && get_priority(op_stack[num_of_ops - 1]) >= get_priority(ch))
+                emit_operation(compiler, op_stack[--num_of_ops]);
+            op_stack[num_of_ops++] = ch;
+            expect_operand = true;
+            i++;
+        } else {
+            return fail(program, "Expected an operation instead of", ch);
+        }
+    }
+
+    if (expect_operand) return fail(program, "Incomplete expression", '\0');
+    while (num_of_ops > 0) {
+        char op = op_stack[--num_of_ops];
+        if (op == '(') return fail(program, "Lack right parenthesis", '\0');
+        emit_operation(compiler, op);
+    }
+    if (program->max_depth > EXPR_MAX_STACK) return fail(program, "Too deep expression", '\0');
+    return true;
+}
+
+bool expr_compile(Program *program, const char *source) {
+    Compiler compiler = { .program = program };
+    char *op_stack = (char*)malloc(strlen(source) + 1);
+
+    if (op_stack == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:expr_compile>\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(program, 0, sizeof(Program));
+
+    bool compiled = compile(&compiler, source, op_stack);
+    free(op_stack);
+    return compiled;
+}
+
+void expr_free(Program *program) {
+    free(program->code);
+    free(program->constants);
+    free(program->variables);
+    program->code = NULL;
+    program->constants = NULL;
+    program->variables = NULL;
+}
+
+int expr_variable(const Program *program, const char *name) {
+    for (int i = 0; i < program->num_of_variables; ++i) {
+        if (strcmp(program->variables[i], name) == 0) return i;
+    }
+    return -1;
+}
@@ -0,0 +1,38 @@
+#include "program.h"
+
+// The values live in an array on the C stack whose size is fixed when the
+// program is compiled (never more than EXPR_MAX_STACK), so an evaluation
+// allocates nothing and only reads the instructions once from start to end.
+
+ExprStatus expr_evaluate(const Program *program, const double *values, double *result) {
+    double stack[EXPR_MAX_STACK];
+    double temporaries[EXPR_MAX_TEMPORARIES];
+    const Instruction *code = program->code;
+    ExprStatus status = EXPR_OK;
+    int top = -1;       // ← The index of the value on the top.
+
+    for (int i = 0; i < program->length; ++i) {
+        switch (code[i].op) {
+            case OP_CONST : stack[++top] = program->constants[code[i].operand]; break;
+            case OP_VAR   : stack[++top] = values[code[i].operand]; break;
+            case OP_NEG   : stack[top] = -stack[top]; break;
+            case OP_ADD   : top--; stack[top] += stack[top + 1]; break;
+            case OP_SUB   : top--; stack[top] -= stack[top + 1]; break;
+            case OP_MUL   : top--; stack[top] *= stack[top + 1]; break;
+            case OP_DIV   :
+                top--;
+                if (stack[top + 1] == 0.0) {
+                    status = EXPR_DIVISION_BY_ZERO;
+                    stack[top] = 0.0;
+                } else {
+                    stack[top] /= stack[top + 1];
+                }
+                break;
+            case OP_STORE : temporaries[code[i].operand] = stack[top]; break;
+            case OP_LOAD  : stack[++top] = temporaries[code[i].operand]; break;
+        }
+    }
+
+    *result = top == 0 ? stack[0] : 0.0;
+    return status;
+}
@@ -0,0 +1,235 @@
+#include "jit.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// The generated function follows the System V calling convention of x86-64
+// Linux: `values` comes in rdi, `result` in rsi and the status goes back in
+// eax. Slot k of the stack is register xmm<k>, and xmm15 is a scratch
+// register for the sign mask of negations and the zero divisions compare
+// with, so an expression may use at most 15 slots.
+//
+// Each instruction of the program becomes at most a few dozen bytes of
+// machine code, so the size of the page is known before writing anything.
+
+#define JIT_REGISTERS 15
+#define SCRATCH 15
+#define MAX_BYTES_PER_INSTRUCTION 48
+
+typedef struct {
+    unsigned char *code;
+    size_t length;
+} Emitter;
+
+static void emit(Emitter *e, unsigned char byte) {
+    e->code[e->length++] = byte;
+}
+
+static void emit_u32(Emitter *e, uint32_t value) {
+    for (int i = 0; i < 4; ++i) emit(e, value >> (8 * i));
+}
+
+static void emit_u64(Emitter *e, uint64_t value) {
+    for (int i = 0; i < 8; ++i) emit(e, value >> (8 * i));
+}
+
+// An SSE2 instruction between two registers, like `addsd xmm<reg>, xmm<rm>`.
+// The REX prefix (needed for xmm8 to xmm15) goes between the mandatory
+// prefix and the 0x0F escape.
+
+static void emit_sse(Emitter *e, unsigned char prefix, unsigned char opcode, int reg, int rm) {
+    emit(e, prefix);
+    if (reg >= 8 || rm >= 8) emit(e, 0x40 | (reg >> 3) << 2 | (rm >> 3));
+    emit(e, 0x0F);
+    emit(e, opcode);
+    emit(e, 0xC0 | (reg & 7) << 3 | (rm & 7));
+}
+
+// movsd xmm<reg>, [rdi + offset]
+
+static void emit_load_value(Emitter *e, int reg, int index) {
+    emit(e, 0xF2);
+    if (reg >= 8) emit(e, 0x44);
+    emit(e, 0x0F);
+    emit(e, 0x10);
+    emit(e, 0x80 | (reg & 7) << 3 | 7);
+    emit_u32(e, (uint32_t)index * sizeof(double));
+}
+
+// movsd xmm<reg>, [rsp - 8 * (temporary + 1)] with opcode 0x10, or the other
+// way round with 0x11. The temporaries of `expr_optimize` are kept below the
+// stack pointer, in the 128 bytes a function that calls no other function may
+// use without reserving them (the red zone), which is room for exactly
+// EXPR_MAX_TEMPORARIES of them.
+
+static void emit_temporary(Emitter *e, unsigned char opcode, int reg, int temporary) {
+    emit(e, 0xF2);
+    if (reg >= 8) emit(e, 0x44);
+    emit(e, 0x0F);
+    emit(e, opcode);
+    emit(e, 0x40 | (reg & 7) << 3 | 4);
+    emit(e, 0x24);
+    emit(e, (unsigned char)(-8 * (temporary + 1)));
+}
+
+// mov rdx, bits ; movq xmm<reg>, rdx
+
+static void emit_load_bits(Emitter *e, int reg, uint64_t bits) {
+    emit(e, 0x48);
+    emit(e, 0xBA);
+    emit_u64(e, bits);
+    emit(e, 0x66);
+    emit(e, 0x48 | (reg >> 3) << 2);
+    emit(e, 0x0F);
+    emit(e, 0x6E);
+    emit(e, 0xC0 | (reg & 7) << 3 | 2);
+}
+
+static void emit_load_constant(Emitter *e, int reg, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    emit_load_bits(e, reg, bits);
+}
+
+// Patches the 8-bit displacement of a jump at `at` to land at the current end
+// of the code.
+
+static void patch_jump(Emitter *e, size_t at) {
+    e->code[at] = (unsigned char)(e->length - (at + 1));
+}
+
+// A division by zero gives 0 and sets the status, exactly like
+// `expr_evaluate`: ucomisd finds the divisor equal to zero only when it's
+// +0 or -0 (a NaN sets the parity flag and is divided by).
+//
+//       xorpd xmm15, xmm15
+//       ucomisd xmm<b>, xmm15
+//       jp divide
+//       jne divide
+//       mov eax, 1
+//       xorpd xmm<a>, xmm<a>
+//       jmp done
+//   divide:
+//       divsd xmm<a>, xmm<b>
+//   done:
+
+static void emit_divide(Emitter *e, int a, int b) {
+    size_t to_divide_parity, to_divide, to_done;
+
+    emit_sse(e, 0x66, 0x57, SCRATCH, SCRATCH);
+    emit_sse(e, 0x66, 0x2E, b, SCRATCH);
+    emit(e, 0x7A);
+    to_divide_parity = e->length;
+    emit(e, 0);
+    emit(e, 0x75);
+    to_divide = e->length;
+    emit(e, 0);
+
+    emit(e, 0xB8);
+    emit_u32(e, EXPR_DIVISION_BY_ZERO);
+    emit_sse(e, 0x66, 0x57, a, a);
+    emit(e, 0xEB);
+    to_done = e->length;
+    emit(e, 0);
+
+    patch_jump(e, to_divide_parity);
+    patch_jump(e, to_divide);
+    emit_sse(e, 0xF2, 0x5E, a, b);
+    patch_jump(e, to_done);
+}
+
+// Writes the code of the whole program, or returns false if it can't be
+// kept in registers.
+
+static bool translate(Emitter *e, const Program *program) {
+    const Instruction *code = program->code;
+    int top = -1;
+
+    emit(e, 0x31);      // ← xor eax, eax
+    emit(e, 0xC0);
+
+    for (int i = 0; i < program->length; ++i) {
+        switch (code[i].op) {
+            case OP_CONST :
+                if (++top >= JIT_REGISTERS) return false;
+                emit_load_constant(e, top, program->constants[code[i].operand]);
+                break;
+            case OP_VAR   :
+                if (++top >= JIT_REGISTERS) return false;
+                emit_load_value(e, top, code[i].operand);
+                break;
+            case OP_NEG   :
+                // Flips the sign bit, as the compiler does for `-x`.
+                emit_load_bits(e, SCRATCH, 0x8000000000000000ULL);
+                emit_sse(e, 0x66, 0x57, top, SCRATCH);
+                break;
+            case OP_ADD   : top--; emit_sse(e, 0xF2, 0x58, top, top + 1); break;
+            case OP_SUB   : top--; emit_sse(e, 0xF2, 0x5C, top, top + 1); break;
+            case OP_MUL   : top--; emit_sse(e, 0xF2, 0x59, top, top + 1); break;
+            case OP_DIV   : top--; emit_divide(e, top, top + 1); break;
+            case OP_STORE : emit_temporary(e, 0x11, top, code[i].operand); break;
+            case OP_LOAD  :
+                if (++top >= JIT_REGISTERS) return false;
+                emit_temporary(e, 0x10, top, code[i].operand);
+                break;
+        }
+        if (top < 0) return false;
+    }
+    if (top != 0) return false;
+
+    emit(e, 0xF2);      // ← movsd [rsi], xmm0
+    emit(e, 0x0F);
+    emit(e, 0x11);
+    emit(e, 0x06);
+    emit(e, 0xC3);      // ← ret
+    return true;
+}
+
+bool expr_jit_compile(JitProgram *jit, const Program *program) {
+    const char *forced = getenv("EXPR_JIT");
+
+    jit->program = program;
+    jit->function = NULL;
+    jit->memory = NULL;
+    jit->size = 0;
+
+#if defined(__x86_64__)
+    if (forced != NULL && strcmp(forced, "off") == 0) return false;
+    if (program->max_depth > JIT_REGISTERS) return false;
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    size_t size = 64 + (size_t)program->length * MAX_BYTES_PER_INSTRUCTION;
+    size = (size + page_size - 1) / page_size * page_size;
+
+    void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return false;
+
+    Emitter e = { .code = memory, .length = 0 };
+    if (!translate(&e, program) || mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, size);
+        return false;
+    }
+
+    jit->memory = memory;
+    jit->size = size;
+    jit->function = (NativeFunction)memory;
+    return true;
+#else
+    (void)forced;
+    return false;
+#endif
+}
+
+void expr_jit_free(JitProgram *jit) {
+    if (jit->memory != NULL) munmap(jit->memory, jit->size);
+    jit->function = NULL;
+    jit->memory = NULL;
+    jit->size = 0;
+}
+
+ExprStatus expr_jit_evaluate(const JitProgram *jit, const double *values, double *result) {
+    if (jit->function != NULL) return jit->function(values, result);
+    return expr_evaluate(jit->program, values, result);
+}
@@ -0,0 +1,58 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <stddef.h>
+#include "program.h"
+
+// Translates a compiled expression into x86-64 machine code, so that
+// evaluating it runs the arithmetic of the expression directly instead of
+// decoding one instruction after another. Every value of the stack lives in a
+// register of its own (xmm0 is the bottom of the stack), a variable is loaded
+// from `values` and each operation is a single SSE2 instruction, so the code
+// of "a * (x + 2)" is
+//
+//   movsd xmm0, [values + 0]       ← VAR a
+//   movsd xmm1, [values + 8]       ← VAR x
+//   mov rdx, 2.0 ; movq xmm2, rdx  ← CONST 2
+//   addsd xmm1, xmm2               ← ADD
+//   mulsd xmm0, xmm1               ← MUL
+//   movsd [result], xmm0
+//
+// The code is written to a page of its own which is made executable (and no
+// longer writable) with `mprotect`. When that's not possible (another
+// processor, a system that forbids executable memory, or an expression that
+// needs more registers than there are), the expression is evaluated by
+// `expr_evaluate` instead, with the same results. EXPR_JIT=off forces that,
+// to compare them.
+
+typedef ExprStatus (*NativeFunction)(const double *values, double *result);
+
+typedef struct {
+    const Program *program;
+    NativeFunction function;    // ← NULL when the interpreter is used.
+    void *memory;
+    size_t size;
+} JitProgram;
+
+/*!
+ * @param [out] [jit] The program to run with `expr_jit_evaluate`.
+ * @param [in] [program] A compiled expression, which must live as long as
+ * `jit`.
+ * @remark Returns true if the expression was translated into machine code and
+ * false if it will be interpreted. Either way `jit` is released with
+ * `expr_jit_free`.
+ */
+bool expr_jit_compile(JitProgram *jit, const Program *program);
+
+/*!
+ * @remark Releases the machine code of `jit`.
+ */
+void expr_jit_free(JitProgram *jit);
+
+/*!
+ * @remark The same as `expr_evaluate` with the program given to
+ * `expr_jit_compile`, bit for bit, status included.
+ */
+ExprStatus expr_jit_evaluate(const JitProgram *jit, const double *values, double *result);
+
+#endif
@@ -0,0 +1,330 @@
+#include "program.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The postfix code is first turned back into the expression it computes, as
+// a graph of nodes where each node is an operation on other nodes. Every
+// node is looked up in a hash table before it's created (hash-consing), so
+// "(a * b + 1) / (a * b + 1)" has a single node for "a * b + 1" that both
+// sides of the division point to. While the nodes are built:
+//
+//   [+] An operation on constants becomes the constant it computes, since
+//       the arithmetic here is the same IEEE arithmetic as at run time. A
+//       division by the constant 0 is kept, to report it when it happens.
+//   [+] x * 1, 1 * x, x / 1, x - 0, x + (-0), (-0) + x and -(-x) are x for
+//       every x, infinities and the signs of zeros included. x + 0 isn't:
+//       -0 + 0 is +0. Nor is x * 0 (which is NaN for infinities) or x - x.
+//
+// Then the code is written again from the graph. A node used more than once
+// is computed the first time and kept in a temporary with STORE, and LOAD
+// takes it back for the other uses.
+
+typedef struct {
+    Opcode op;
+    int left, right;    // ← Nodes, or -1.
+    int operand;        // ← The variable of OP_VAR.
+    double value;       // ← The value of OP_CONST.
+    int uses;
+    int temporary;      // ← Where it's kept once computed, or -1.
+    int constant;       // ← The index of OP_CONST in the new constants, or -1.
+} Node;
+
+typedef struct {
+    Node *nodes;
+    int num_of_nodes;
+    int *table;         // ← Indices of nodes, -1 for empty entries.
+    int table_size;
+} Graph;
+
+typedef struct {
+    Instruction *code;
+    int length;
+    double *constants;
+    int num_of_constants;
+    int num_of_temporaries;
+} Writer;
+
+static uint64_t bits_of(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static bool is_constant(const Graph *graph, int node, double value) {
+    return graph->nodes[node].op == OP_CONST && bits_of(graph->nodes[node].value) == bits_of(value);
+}
+
+static bool same_node(const Node *a, const Node *b) {
+    return a->op == b->op && a->left == b->left && a->right == b->right &&
+        a->operand == b->operand && bits_of(a->value) == bits_of(b->value);
+}
+
+static unsigned hash_node(const Node *node) {
+    uint64_t h = bits_of(node->value) * 0x9E3779B97F4A7C15ULL;
+    h ^= (uint64_t)node->op * 0xC2B2AE3D27D4EB4FULL;
+    h ^= ((uint64_t)(unsigned)node->left << 32 | (unsigned)node->right) * 0x165667B19E3779F9ULL;
+    h ^= (uint64_t)(unsigned)node->operand * 0x27D4EB2F165667C5ULL;
+    return (unsigned)(h ^ h >> 29);
+}
+
+// Returns the node equal to `node`, adding it if there's none yet.
+
+static int intern(Graph *graph, Node node) {
+    unsigned slot = hash_node(&node) & (graph->table_size - 1);
+
+    while (graph->table[slot] >= 0) {
+        if (same_node(&graph->nodes[graph->table[slot]], &node)) return graph->table[slot];
+        slot = (slot + 1) & (graph->table_size - 1);
+    }
+
+    node.uses = 0;
+    node.temporary = -1;
+    node.constant = -1;
+    graph->nodes[graph->num_of_nodes] = node;
+    graph->table[slot] = graph->num_of_nodes;
+    return graph->num_of_nodes++;
+}
+
+static int make_constant(Graph *graph, double value) {
+    Node node = { .op = OP_CONST, .left = -1, .right = -1, .value = value };
+    return intern(graph, node);
+}
+
+static int make_negation(Graph *graph, int child) {
+    const Node *operand = &graph->nodes[child];
+
+    if (operand->op == OP_CONST) return make_constant(graph, -operand->value);
+    if (operand->op == OP_NEG) return operand->left;
+
+    Node node = { .op = OP_NEG, .left = child, .right = -1 };
+    return intern(graph, node);
+}
+
+static int make_operation(Graph *graph, Opcode op, int left, int right) {
+    const Node *a = &graph->nodes[left], *b = &graph->nodes[right];
+
+    if (a->op == OP_CONST && b->op == OP_CONST) {
+        switch (op) {
+            case OP_ADD : return make_constant(graph, a->value + b->value);
+            case OP_SUB : return make_constant(graph, a->value - b->value);
+            case OP_MUL : return make_constant(graph, a->value * b->value);
+            default     :
+                if (b->value != 0.0) return make_constant(graph, a->value / b->value);
+                break;
+        }
+    }
+
+    switch (op) {
+        case OP_MUL :
+            if (is_constant(graph, right, 1.0)) return left;
+            if (is_constant(graph, left, 1.0)) return right;
+            break;
+        case OP_DIV :
+            if (is_constant(graph, right, 1.0)) return left;
+            break;
+        case OP_SUB :
+            if (is_constant(graph, right, 0.0)) return left;
+            break;
+        case OP_ADD :
+            if (is_constant(graph, right, -0.0)) return left;
+            if (is_constant(graph, left, -0.0)) return right;
+            break;
+        default     : break;
+    }
+
+    Node node = { .op = op, .left = left, .right = right };
+    return intern(graph, node);
+}
+
+// Builds the graph of the program and returns its root.
+
+static int build(Graph *graph, const Program *program) {
+    int stack[EXPR_MAX_STACK];
+    int top = -1;
+
+    for (int i = 0; i < program->length; ++i) {
+        const Instruction *instruction = &program->code[i];
+
+        switch (instruction->op) {
+            case OP_CONST :
+                stack[++top] = make_constant(graph, program->constants[instruction->operand]);
+                break;
+            case OP_VAR   : {
+                Node node = { .op = OP_VAR, .left = -1, .right = -1, .operand = instruction->operand };
+                stack[++top] = intern(graph, node);
+                break;
+            }
+            case OP_NEG   : stack[top] = make_negation(graph, stack[top]); break;
+            case OP_ADD   :
+            case OP_SUB   :
+            case OP_MUL   :
+            case OP_DIV   :
+                top--;
+                stack[top] = make_operation(graph, instruction->op, stack[top], stack[top + 1]);
+                break;
+            default       : return -1;  // ← Already optimized.
+        }
+    }
+    return top == 0 ? stack[0] : -1;
+}
+
+// Counts how many times each node is used by the nodes that are still part of
+// the expression (a node may have been replaced by a constant after it was
+// created). The graph of "a + a + ... + a" is as deep as the expression is
+// long, so it's walked with a stack of its own instead of by recursion, which
+// could overflow the C stack. Every node adds at most its two operands to
+// `pending` the first time it's seen.
+
+static void count_uses(Graph *graph, int root, int *pending) {
+    int top = 0;
+
+    pending[top++] = root;
+    while (top > 0) {
+        Node *n = &graph->nodes[pending[--top]];
+
+        if (n->uses++ > 0) continue;
+        if (n->right >= 0) pending[top++] = n->right;
+        if (n->left >= 0) pending[top++] = n->left;
+    }
+}
+
+static void write_instruction(Writer *writer, Opcode op, int operand) {
+    writer->code[writer->length].op = op;
+    writer->code[writer->length].operand = operand;
+    writer->length++;
+}
+
+// Writes the code of a node after the code of its operands, left first.
+// Every node on the way down is kept in `pending` with how far it's written:
+// 0 when nothing is, 1 when its left operand is, 2 when both are.
+
+typedef struct {
+    int node;
+    int written;
+} Pending;
+
+static void write_node(Writer *writer, Graph *graph, int root, Pending *pending) {
+    int top = 0;
+
+    pending[top++] = (Pending){ root, 0 };
+    while (top > 0) {
+        Pending *p = &pending[top - 1];
+        Node *n = &graph->nodes[p->node];
+
+        if (p->written == 0) {
+            if (n->temporary >= 0) {
+                write_instruction(writer, OP_LOAD, n->temporary);
+                top--;
+                continue;
+            }
+            if (n->op == OP_CONST) {
+                if (n->constant < 0) {
+                    n->constant = writer->num_of_constants++;
+                    writer->constants[n->constant] = n->value;
+                }
+                write_instruction(writer, OP_CONST, n->constant);
+                top--;
+                continue;
+            }
+            if (n->op == OP_VAR) {
+                write_instruction(writer, OP_VAR, n->operand);
+                top--;
+                continue;
+            }
+            p->written = 1;
+            pending[top++] = (Pending){ n->left, 0 };
+            continue;
+        }
+        if (p->written == 1 && n->right >= 0) {
+            p->written = 2;
+            pending[top++] = (Pending){ n->right, 0 };
+            continue;
+        }
+
+        write_instruction(writer, n->op, 0);
+        // Loading a constant or a variable is as cheap as loading a temporary.
+        if (n->uses > 1 && writer->num_of_temporaries < EXPR_MAX_TEMPORARIES) {
+            n->temporary = writer->num_of_temporaries++;
+            write_instruction(writer, OP_STORE, n->temporary);
+        }
+        top--;
+    }
+}
+
+static int measure_depth(const Instruction *code, int length) {
+    int depth = 0, max_depth = 0;
+
+    for (int i = 0; i < length; ++i) {
+        switch (code[i].op) {
+            case OP_CONST :
+            case OP_VAR   :
+            case OP_LOAD  : depth++; break;
+            case OP_NEG   :
+            case OP_STORE : break;
+            default       : depth--; break;
+        }
+        if (depth > max_depth) max_depth = depth;
+    }
+    return max_depth;
+}
+
+void expr_optimize(Program *program) {
+    Graph graph;
+    Writer writer;
+
+    if (program->length == 0) return;
+
+    graph.num_of_nodes = 0;
+    graph.table_size = 16;
+    while (graph.table_size < 2 * program->length) graph.table_size *= 2;
+    graph.nodes = (Node*)malloc(program->length * sizeof(Node));
+    graph.table = (int*)malloc(graph.table_size * sizeof(int));
+
+    // Every node of the graph but a stored one is written at most once, and
+    // a stored node is written instead of a whole subexpression, so the new
+    // code is never longer than the old one.
+    writer.code = (Instruction*)malloc(program->length * sizeof(Instruction));
+    writer.constants = (double*)malloc(program->length * sizeof(double));
+    writer.length = 0;
+    writer.num_of_constants = 0;
+    writer.num_of_temporaries = 0;
+
+    // The deepest path of the graph has at most one node per instruction.
+    Pending *pending = (Pending*)malloc(program->length * sizeof(Pending));
+    int *uses_pending = (int*)malloc((2 * program->length + 1) * sizeof(int));
+
+    if (
+        graph.nodes == NULL || graph.table == NULL || writer.code == NULL ||
+        writer.constants == NULL || pending == NULL || uses_pending == NULL
+    ) {
+        fprintf(stderr, "[Error] : malloc failed in <function:expr_optimize>\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(graph.table, -1, graph.table_size * sizeof(int));
+
+    int root = build(&graph, program);
+    if (root >= 0) {
+        count_uses(&graph, root, uses_pending);
+        write_node(&writer, &graph, root, pending);
+    }
+
+    if (root >= 0 && writer.length <= program->length) {
+        free(program->code);
+        free(program->constants);
+        program->code = writer.code;
+        program->length = writer.length;
+        program->constants = writer.constants;
+        program->num_of_constants = writer.num_of_constants;
+        program->num_of_temporaries = writer.num_of_temporaries;
+        program->max_depth = measure_depth(writer.code, writer.length);
+    } else {
+        free(writer.code);
+        free(writer.constants);
+    }
+    free(graph.nodes);
+    free(graph.table);
+    free(pending);
+    free(uses_pending);
+}
@@ -0,0 +1,506 @@
+#include "parallel.h"
+#include "../../common/number.h"
+#include "../../common/stack.h"
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// A line is evaluated directly by the shunting-yard algorithm of
+// `expr_compile` (a '-' where a number is expected is the negation 'n'), but
+// every operation is computed as soon as it leaves the operation stack
+// instead of being written out as an instruction. That gives the values of
+// `expr_evaluate` bit for bit, without compiling anything.
+
+STACK_DEFINE(OpStack, op_stack, char, 64)
+STACK_DEFINE(NumStack, num_stack, double, 64)
+
+typedef enum {
+    LINE_OK,
+    LINE_DIVISION_BY_ZERO,
+    LINE_INVALID
+} LineStatus;
+
+static int get_priority(char op) {
+    switch (op) {
+        case '(' : return 0;
+        case '+' :
+        case '-' : return 1;
+        case '*' :
+        case '/' : return 2;
+        case 'n' : return 3;
+        default  : return -1;
+    }
+}
+
+static void apply(NumStack *nums, char op, LineStatus *status) {
+    if (op == 'n') {
+        nums->items[nums->length - 1] = -nums->items[nums->length - 1];
+        return;
+    }
+
+    double b = num_stack_pop(nums);
+    double *a = &nums->items[nums->length - 1];
+    switch (op) {
+        case '+' : *a += b; break;
+        case '-' : *a -= b; break;
+        case '*' : *a *= b; break;
+        case '/' :
+            if (b == 0.0) {
+                *status = LINE_DIVISION_BY_ZERO;
+                *a = 0.0;
+            } else {
+                *a /= b;
+            }
+            break;
+    }
+}
+
+static LineStatus evaluate_line(
+    const char *p, const char *end, OpStack *ops, NumStack *nums, double *result
+) {
+    LineStatus status = LINE_OK;
+    bool expect_operand = true;
+
+    op_stack_clear(ops);
+    num_stack_clear(nums);
+    while (p < end) {
+        char ch = *p;
+
+        if (ch == ' ' || ch == '\t' || ch == '\r') {
+            p++;
+            continue;
+        }
+
+        if (expect_operand) {
+            if (isdigit((unsigned char)ch) || ch == '.') {
+                double num;
+                const char *stop = number_parse(p, end, &num);
+
+                if (stop == p) return LINE_INVALID;
+                num_stack_push(nums, num);
+                p = stop;
+                expect_operand = false;
+            } else if (ch == '(') {
+                op_stack_push(ops, '(');
+                p++;
+            } else if (ch == '-') {
+                op_stack_push(ops, 'n');
+                p++;
+            } else {
+                return LINE_INVALID;
+            }
+        } else if (ch == ')') {
+            while (!op_stack_is_empty(ops) && op_stack_top(ops) != '(')
+                apply(nums, op_stack_pop(ops), &status);
+            if (op_stack_is_empty(ops)) return LINE_INVALID;
+            op_stack_pop(ops);
+            p++;
+        } else if (ch == '+' || ch == '-' || ch == '*' || ch == '/') {
+            while (!op_stack_is_empty(ops) && get_priority(op_stack_top(ops)) >= get_priority(ch))
+                apply(nums, op_stack_pop(ops), &status);
+            op_stack_push(ops, ch);
+            expect_operand = true;
+            p++;
+        } else {
+            return LINE_INVALID;
+        }
+    }
+
+    if (expect_operand) return LINE_INVALID;
+    while (!op_stack_is_empty(ops)) {
+        char op = op_stack_pop(ops);
+        if (op == '(') return LINE_INVALID;
+        apply(nums, op, &status);
+    }
+    *result = num_stack_top(nums);
+    return status;
+}
+
+// What a chunk gives: its values as text, and the lines (counted from the
+// beginning of the chunk) that must be reported.
+
+typedef struct {
+    long line;
+    LineStatus status;
+} LineError;
+
+typedef struct {
+    const char *begin;
+    const char *end;
+
+    char *output;
+    size_t output_length;
+    size_t output_capacity;
+
+    LineError *errors;
+    int num_of_errors;
+    int errors_capacity;
+
+    long num_of_lines;      // ← All the lines, to number the ones after it.
+    long num_of_values;
+} Chunk;
+
+// The deque of a thread holds the chunks chunks[next] to chunks[end - 1].
+// Both ends are in one word, so that taking the next chunk and stealing the
+// last one are each a single compare-and-swap, without any lock.
+
+typedef struct {
+    _Atomic uint64_t range;
+} Deque;
+
+static uint64_t make_range(uint32_t next, uint32_t end) {
+    return (uint64_t)end << 32 | next;
+}
+
+typedef struct Pool Pool;
+
+typedef struct {
+    Pool *pool;
+    int index;
+    pthread_t thread;
+    OpStack ops;
+    NumStack nums;
+} Worker;
+
+struct Pool {
+    Chunk *chunks;          // ← Two windows, one evaluated while the other is written.
+    int window_size;
+    Deque *deques;
+    Worker *workers;
+    int num_of_workers;
+
+    pthread_mutex_t lock;
+    pthread_cond_t start;   // ← A window was given out, or `stop`.
+    pthread_cond_t done;    // ← Every worker has run out of chunks.
+    long generation;
+    int num_of_busy;
+    bool stop;
+};
+
+static void* allocate(size_t size) {
+    void *memory = calloc(1, size);
+    if (memory == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:expr_evaluate_file>\n");
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+static void* grow(void *memory, size_t size) {
+    memory = realloc(memory, size);
+    if (memory == NULL) {
+        fprintf(stderr, "[Error] : realloc failed in <function:grow>\n");
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+static void add_error(Chunk *chunk, long line, LineStatus status) {
+    if (chunk->num_of_errors == chunk->errors_capacity) {
+        chunk->errors_capacity = chunk->errors_capacity > 0 ? 2 * chunk->errors_capacity : 16;
+        chunk->errors = grow(chunk->errors, chunk->errors_capacity * sizeof(LineError));
+    }
+    chunk->errors[chunk->num_of_errors].line = line;
+    chunk->errors[chunk->num_of_errors].status = status;
+    chunk->num_of_errors++;
+}
+
+static void evaluate_chunk(Worker *worker, Chunk *chunk) {
+    const char *p = chunk->begin;
+
+    chunk->output_length = 0;
+    chunk->num_of_errors = 0;
+    chunk->num_of_lines = 0;
+    chunk->num_of_values = 0;
+    while (p < chunk->end) {
+        const char *newline = memchr(p, '\n', chunk->end - p);
+        const char *line_end = newline != NULL ? newline : chunk->end;
+        const char *next = newline != NULL ? newline + 1 : chunk->end;
+        long line = chunk->num_of_lines++;
+
+        if (line_end > p && line_end[-1] == '\r') line_end--;
+        if (line_end == p) {
+            p = next;
+            continue;
+        }
+
+        // A value is never longer than "-2.2250738585072014e-308\n".
+        if (chunk->output_capacity - chunk->output_length < 32) {
+            chunk->output_capacity = chunk->output_capacity > 0 ? 2 * chunk->output_capacity : EXPR_CHUNK_SIZE;
+            chunk->output = grow(chunk->output, chunk->output_capacity);
+        }
+
+        double result = 0.0;
+        LineStatus status = evaluate_line(p, line_end, &worker->ops, &worker->nums, &result);
+        char *out = chunk->output + chunk->output_length;
+        if (status == LINE_INVALID) {
+            memcpy(out, "nan\n", 4);
+            chunk->output_length += 4;
+        } else {
+            chunk->output_length += snprintf(out, 32, "%.17g\n", result);
+        }
+        if (status != LINE_OK) add_error(chunk, line, status);
+        chunk->num_of_values++;
+        p = next;
+    }
+}
+
+static long take(Deque *deque) {
+    uint64_t range = atomic_load(&deque->range);
+    while ((uint32_t)range < (uint32_t)(range >> 32)) {
+        uint32_t next = (uint32_t)range, end = range >> 32;
+        if (atomic_compare_exchange_weak(&deque->range, &range, make_range(next + 1, end)))
+            return next;
+    }
+    return -1;
+}
+
+static long steal(Deque *deque) {
+    uint64_t range = atomic_load(&deque->range);
+    while ((uint32_t)range < (uint32_t)(range >> 32)) {
+        uint32_t next = (uint32_t)range, end = range >> 32;
+        if (atomic_compare_exchange_weak(&deque->range, &range, make_range(next, end - 1)))
+            return end - 1;
+    }
+    return -1;
+}
+
+static void* work(void *argument) {
+    Worker *worker = argument;
+    Pool *pool = worker->pool;
+    long generation = 0;
+
+    while (true) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->generation == generation && !pool->stop)
+            pthread_cond_wait(&pool->start, &pool->lock);
+        generation = pool->generation;
+        bool stop = pool->stop;
+        pthread_mutex_unlock(&pool->lock);
+        if (stop) return NULL;
+
+        // Nothing is added to the deques until the window is over, so once
+        // every deque is empty there's nothing left to do.
+        while (true) {
+            long chunk = take(&pool->deques[worker->index]);
+            for (int i = 1; chunk < 0 && i < pool->num_of_workers; ++i)
+                chunk = steal(&pool->deques[(worker->index + i) % pool->num_of_workers]);
+            if (chunk < 0) break;
+            evaluate_chunk(worker, &pool->chunks[chunk]);
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->num_of_busy == 0) pthread_cond_signal(&pool->done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+// Gives the chunks chunks[first] to chunks[first + count - 1] out to the
+// workers, in runs of neighbouring chunks, and wakes them up.
+
+static void start_window(Pool *pool, int first, int count) {
+    int num_of_workers = pool->num_of_workers;
+
+    pthread_mutex_lock(&pool->lock);
+    for (int w = 0; w < num_of_workers; ++w) {
+        uint32_t next = first + (long)count * w / num_of_workers;
+        uint32_t end = first + (long)count * (w + 1) / num_of_workers;
+        atomic_store(&pool->deques[w].range, make_range(next, end));
+    }
+    pool->num_of_busy = num_of_workers;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void wait_window(Pool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->num_of_busy > 0) pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static bool write_all(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        length -= written;
+    }
+    return true;
+}
+
+static void write_window(Chunk *chunks, int count, int out, FileStats *stats, long *line_number) {
+    for (int c = 0; c < count; ++c) {
+        Chunk *chunk = &chunks[c];
+
+        if (!write_all(out, chunk->output, chunk->output_length)) {
+            perror("[Error] : write failed in <function:write_window>");
+            exit(EXIT_FAILURE);
+        }
+        for (int e = 0; e < chunk->num_of_errors; ++e) {
+            long line = *line_number + chunk->errors[e].line + 1;
+            if (chunk->errors[e].status == LINE_INVALID) {
+                fprintf(stderr, "[Error] : Invalid expression in line %ld\n", line);
+                stats->num_of_invalid++;
+            } else {
+                fprintf(stderr, "[Error] : Division by zero in line %ld\n", line);
+                stats->num_of_divisions_by_zero++;
+            }
+        }
+        stats->num_of_lines += chunk->num_of_values;
+        *line_number += chunk->num_of_lines;
+    }
+}
+
+// The end of the chunk that starts at `p`: the end of the line where it
+// reaches EXPR_CHUNK_SIZE bytes.
+
+static const char* chunk_end(const char *p, const char *end) {
+    if (end - p <= EXPR_CHUNK_SIZE) return end;
+    const char *newline = memchr(p + EXPR_CHUNK_SIZE, '\n', end - p - EXPR_CHUNK_SIZE);
+    return newline != NULL ? newline + 1 : end;
+}
+
+// Reads all of `fd`, which can't be mapped (a pipe, a terminal), into memory.
+// Returns NULL if it can't be read.
+
+static char* read_all(int fd, size_t *size) {
+    size_t capacity = 1 << 16, length = 0;
+    char *data = allocate(capacity);
+
+    while (true) {
+        if (length == capacity) {
+            capacity *= 2;
+            char *larger = realloc(data, capacity);
+            if (larger == NULL) {
+                fprintf(stderr, "[Error] : realloc failed in <function:read_all>\n");
+                exit(EXIT_FAILURE);
+            }
+            data = larger;
+        }
+        ssize_t count = read(fd, data + length, capacity - length);
+        if (count == 0) break;
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            perror("[Error] : read failed in <function:expr_evaluate_file>");
+            free(data);
+            return NULL;
+        }
+        length += count;
+    }
+    *size = length;
+    return data;
+}
+
+bool expr_evaluate_file(const char *path, int num_of_threads, int out, FileStats *stats) {
+    memset(stats, 0, sizeof(FileStats));
+
+    int fd = open(path, O_RDONLY);
+    struct stat status;
+    if (fd < 0 || fstat(fd, &status) < 0) {
+        perror("[Error] : open failed in <function:expr_evaluate_file>");
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    size_t size = status.st_size;
+    const char *data = NULL;
+    bool is_mapped = S_ISREG(status.st_mode);     // ← Otherwise st_size says nothing of what's in it.
+    if (!is_mapped) {
+        data = read_all(fd, &size);
+        if (data == NULL) {
+            close(fd);
+            return false;
+        }
+    } else if (size > 0) {
+        data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            perror("[Error] : mmap failed in <function:expr_evaluate_file>");
+            close(fd);
+            return false;
+        }
+        madvise((void*)data, size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    if (num_of_threads <= 0) num_of_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_of_threads <= 0) num_of_threads = 1;
+
+    Pool pool = { .num_of_workers = num_of_threads };
+    pool.window_size = EXPR_WINDOW_CHUNKS * num_of_threads;
+    pool.chunks = allocate(2 * pool.window_size * sizeof(Chunk));
+    pool.deques = allocate(num_of_threads * sizeof(Deque));
+    pool.workers = allocate(num_of_threads * sizeof(Worker));
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.start, NULL);
+    pthread_cond_init(&pool.done, NULL);
+
+    for (int w = 0; w < num_of_threads; ++w) {
+        Worker *worker = &pool.workers[w];
+        worker->pool = &pool;
+        worker->index = w;
+        op_stack_init(&worker->ops);
+        num_stack_init(&worker->nums);
+        if (pthread_create(&worker->thread, NULL, work, worker) != 0) {
+            fprintf(stderr, "[Error] : pthread_create failed in <function:expr_evaluate_file>\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    const char *p = data, *end = data + size;
+    long line_number = 0;
+    int window = 0, previous_count = 0;
+    while (true) {
+        Chunk *chunks = pool.chunks + window * pool.window_size;
+        int count = 0;
+
+        while (count < pool.window_size && p < end) {
+            chunks[count].begin = p;
+            p = chunk_end(p, end);
+            chunks[count].end = p;
+            count++;
+        }
+        if (count > 0) start_window(&pool, window * pool.window_size, count);
+        if (previous_count > 0)
+            write_window(pool.chunks + (1 - window) * pool.window_size, previous_count, out, stats, &line_number);
+        if (count == 0) break;
+
+        wait_window(&pool);
+        previous_count = count;
+        window = 1 - window;
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    pool.stop = true;
+    pthread_cond_broadcast(&pool.start);
+    pthread_mutex_unlock(&pool.lock);
+    for (int w = 0; w < num_of_threads; ++w) {
+        pthread_join(pool.workers[w].thread, NULL);
+        op_stack_free(&pool.workers[w].ops);
+        num_stack_free(&pool.workers[w].nums);
+    }
+    for (int c = 0; c < 2 * pool.window_size; ++c) {
+        free(pool.chunks[c].output);
+        free(pool.chunks[c].errors);
+    }
+    free(pool.chunks);
+    free(pool.deques);
+    free(pool.workers);
+    pthread_mutex_destroy(&pool.lock);
+    pthread_cond_destroy(&pool.start);
+    pthread_cond_destroy(&pool.done);
+    if (!is_mapped) free((void*)data);
+    else if (size > 0) munmap((void*)data, size);
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stdbool.h>
+
+// Evaluates a whole file of expressions without variables, one per line, on
+// several threads. The file is mapped into memory with `mmap` (or read into
+// it, if it's a pipe or anything else that can't be mapped) and cut into
+// chunks of about EXPR_CHUNK_SIZE bytes at the ends of lines, so that every
+// chunk holds whole lines and can be evaluated on its own:
+//
+//   [+] Each thread has a deque of chunks to evaluate, taken from its front.
+//       A thread whose deque is empty steals from the back of the deque of
+//       another one, so a thread slowed down by long lines doesn't hold the
+//       others back;
+//   [+] A thread writes the values of its chunk into a buffer of the chunk,
+//       with its own stacks, which are kept from one line to the next (see
+//       `common/stack.h`), so nothing is allocated once they're large enough;
+//   [+] The chunks are given out EXPR_WINDOW_CHUNKS per thread at a time.
+//       While the threads evaluate them, the values of the previous ones are
+//       written in the order of the file, so the memory used doesn't grow
+//       with the size of the file.
+
+#define EXPR_CHUNK_SIZE (1 << 18)
+#define EXPR_WINDOW_CHUNKS 16
+
+typedef struct {
+    long num_of_lines;              // ← Lines with an expression.
+    long num_of_invalid;
+    long num_of_divisions_by_zero;
+} FileStats;
+
+/*!
+ * @param [in] [path] The file of expressions, as `calculate_expression` reads
+ * them. Empty lines are skipped.
+ * @param [in] [num_of_threads] How many threads evaluate it, or 0 for one per
+ * processor.
+ * @param [in] [out] The file descriptor the values are written to, one line
+ * per expression in the order of the file: the value with 17 digits, or nan
+ * if the expression isn't valid.
+ * @param [out] [stats] What was evaluated.
+ * @remark Returns false if the file can't be read. A division by zero gives
+ * 0, as in `expr_evaluate`, and it's reported on stderr with the number of its
+ * line, like invalid expressions.
+ */
+bool expr_evaluate_file(const char *path, int num_of_threads, int out, FileStats *stats);
+
+#endif
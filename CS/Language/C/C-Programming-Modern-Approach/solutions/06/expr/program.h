@@ -0,0 +1,100 @@
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include <stdbool.h>
+
+// An expression compiled once into postfix code for a small stack machine, so
+// that evaluating it again for other values of its variables doesn't read the
+// text again. "a * (x + 2)" becomes
+//
+//   VAR a, VAR x, CONST 2, ADD, MUL
+//
+// where every instruction pushes a value or replaces the values on the top of
+// the stack by the result of an operation, exactly in the order the
+// shunting-yard algorithm of `calculate_expression` computes them.
+
+#define EXPR_MAX_STACK 64       // ← The deepest stack an expression may need.
+#define EXPR_MAX_NAME 32        // ← The longest name of a variable, with '\0'.
+#define EXPR_MAX_TEMPORARIES 16 // ← The most values `expr_optimize` keeps aside.
+
+typedef enum {
+    OP_CONST,   // ← Pushes constants[operand].
+    OP_VAR,     // ← Pushes the value of variables[operand].
+    OP_NEG,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_STORE,   // ← Copies the top of the stack to temporaries[operand].
+    OP_LOAD     // ← Pushes temporaries[operand].
+} Opcode;
+
+typedef struct {
+    Opcode op;
+    int operand;
+} Instruction;
+
+typedef struct {
+    Instruction *code;
+    int length;
+
+    double *constants;
+    int num_of_constants;
+
+    char (*variables)[EXPR_MAX_NAME];
+    int num_of_variables;
+
+    int max_depth;      // ← The most values on the stack at the same time.
+    int num_of_temporaries;
+    char error[80];     // ← Why the expression couldn't be compiled.
+} Program;
+
+typedef enum {
+    EXPR_OK = 0,
+    EXPR_DIVISION_BY_ZERO = 1
+} ExprStatus;
+
+/*!
+ * @param [out] [program] The compiled expression.
+ * @param [in] [source] An expression of numbers, variables (a letter or '_'
+ * followed by letters, digits and '_'), + - * / and parentheses.
+ * @remark Returns false and describes the problem in `program->error` if the
+ * expression is not valid. Either way `program` is released with
+ * `expr_free`.
+ */
+bool expr_compile(Program *program, const char *source);
+
+/*!
+ * @remark Rewrites a compiled expression into code that computes the same
+ * values (bit for bit, divisions by zero included) with fewer instructions:
+ * operations on constants are computed once here, a subexpression that
+ * appears several times is computed once and kept in a temporary, and x * 1,
+ * 1 * x, x / 1, x - 0, x + (-0), (-0) + x and -(-x) become x (see
+ * `optimize.c`).
+ */
+void expr_optimize(Program *program);
+
+/*!
+ * @remark Releases the memory of a compiled expression.
+ */
+void expr_free(Program *program);
+
+/*!
+ * @param [in] [name] The name of a variable.
+ * @remark Returns the index of the variable in `program->variables`, which is
+ * where its value goes in the `values` of `expr_evaluate`, or -1 if the
+ * expression doesn't use it.
+ */
+int expr_variable(const Program *program, const char *name);
+
+/*!
+ * @param [in] [values] The value of every variable of the program, in the
+ * order of `program->variables`.
+ * @param [out] [result] The value of the expression.
+ * @remark Evaluates the program without allocating any memory. A division by
+ * zero gives 0, like `calculate` does, and makes the status
+ * EXPR_DIVISION_BY_ZERO.
+ */
+ExprStatus expr_evaluate(const Program *program, const double *values, double *result);
+
+#endif
@@ -0,0 +1,475 @@
+#include "server.h"
+#include "session.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+typedef struct Connection {
+    int fd;
+    unsigned int interest;      // ← The events epoll watches for it.
+
+    char *input;                // ← What it sent, input[start] to input[length - 1] not answered yet.
+    size_t start;
+    size_t length;
+    size_t capacity;
+
+    char *pending;              // ← Answers it hasn't received yet.
+    size_t pending_length;
+    size_t pending_capacity;
+
+    size_t batch_start;         // ← Its answers in the buffer of the batch.
+    size_t batch_end;
+    bool in_batch;
+    bool reading_closed;        // ← It won't send anything else.
+    bool failed;
+    struct Connection *next_in_batch;
+} Connection;
+
+static volatile sig_atomic_t stopping = 0;
+
+static void stop(int signal_number) {
+    (void)signal_number;
+    stopping = 1;
+}
+
+static void* grow(void *memory, size_t size) {
+    memory = realloc(memory, size);
+    if (memory == NULL) {
+        fprintf(stderr, "[Error] : realloc failed in <function:grow>\n");
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+static bool make_address(struct sockaddr_un *address, const char *path) {
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address->sun_path)) {
+        fprintf(stderr, "[Error] : Too long path of a socket %s\n", path);
+        return false;
+    }
+    strcpy(address->sun_path, path);
+    return true;
+}
+
+// Makes room for the socket at `path`: nothing may be there but the socket
+// of a daemon that's gone, which refuses connections. A file, or the socket
+// of a daemon still running, is left alone.
+
+static bool remove_stale_socket(const char *path, const struct sockaddr_un *address) {
+    struct stat status;
+
+    if (lstat(path, &status) < 0) {
+        if (errno == ENOENT) return true;
+        perror("[Error] : lstat failed in <function:remove_stale_socket>");
+        return false;
+    }
+    if (!S_ISSOCK(status.st_mode)) {
+        fprintf(stderr, "[Error] : %s exists and isn't a socket\n", path);
+        return false;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    int connected = connect(fd, (const struct sockaddr*)address, sizeof(*address));
+    int error = errno;
+    close(fd);
+    if (connected == 0) {
+        fprintf(stderr, "[Error] : A daemon already answers at %s\n", path);
+        return false;
+    }
+    if (error != ECONNREFUSED) {
+        errno = error;
+        perror("[Error] : connect failed in <function:remove_stale_socket>");
+        return false;
+    }
+    return unlink(path) == 0 || errno == ENOENT;
+}
+
+static void watch(int epoll, Connection *connection) {
+    unsigned int interest = 0;
+
+    if (!connection->reading_closed && connection->pending_length <= SERVER_MAX_REQUEST)
+        interest |= EPOLLIN;
+    if (connection->pending_length > 0) interest |= EPOLLOUT;
+    if (interest == connection->interest) return;
+
+    struct epoll_event event = { .events = interest, .data.ptr = connection };
+    epoll_ctl(epoll, EPOLL_CTL_MOD, connection->fd, &event);
+    connection->interest = interest;
+}
+
+static void close_connection(int epoll, Connection *connection) {
+    epoll_ctl(epoll, EPOLL_CTL_DEL, connection->fd, NULL);
+    close(connection->fd);
+    free(connection->input);
+    free(connection->pending);
+    free(connection);
+}
+
+static void accept_connections(int epoll, int listener, ServerStats *stats) {
+    while (true) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) return;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+        Connection *connection = calloc(1, sizeof(Connection));
+        if (connection == NULL) {
+            fprintf(stderr, "[Error] : malloc failed in <function:accept_connections>\n");
+            exit(EXIT_FAILURE);
+        }
+        connection->fd = fd;
+        connection->interest = EPOLLIN;
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = connection };
+        if (epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event) < 0) {
+            close(fd);
+            free(connection);
+            continue;
+        }
+        stats->num_of_connections++;
+    }
+}
+
+// Reads what the connection has sent, until it would block or there's more
+// than the longest request to answer.
+
+static void read_requests(Connection *connection) {
+    while (connection->length - connection->start <= SERVER_MAX_REQUEST) {
+        if (connection->start > 0 && connection->start == connection->length)
+            connection->start = connection->length = 0;
+        if (connection->capacity - connection->length < SERVER_READ_SIZE) {
+            if (connection->start > 0) {
+                memmove(connection->input, connection->input + connection->start, connection->length - connection->start);
+                connection->length -= connection->start;
+                connection->start = 0;
+            }
+            if (connection->capacity - connection->length < SERVER_READ_SIZE) {
+                connection->capacity = connection->capacity > 0 ? 2 * connection->capacity : 2 * SERVER_READ_SIZE;
+                connection->input = grow(connection->input, connection->capacity);
+            }
+        }
+
+        ssize_t count = read(connection->fd, connection->input + connection->length, connection->capacity - connection->length);
+        if (count > 0) {
+            connection->length += count;
+            if (count < SERVER_READ_SIZE) return;
+        } else if (count == 0) {
+            connection->reading_closed = true;
+            return;
+        } else {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                connection->reading_closed = true;
+                connection->failed = true;
+            }
+            return;
+        }
+    }
+}
+
+static void add_text(ReplyBuffer *reply, const char *text) {
+    size_t length = strlen(text);
+
+    if (reply->capacity - reply->length < length) {
+        reply->capacity = 2 * (reply->length + length);
+        reply->data = grow(reply->data, reply->capacity);
+    }
+    memcpy(reply->data + reply->length, text, length);
+    reply->length += length;
+}
+
+// Answers the whole requests of the connection, and the last one too if it
+// won't send the rest of it.
+
+static long answer_requests(Session *session, Connection *connection, ReplyBuffer *reply) {
+    long num_of_requests = 0;
+
+    while (connection->start < connection->length) {
+        char *line = connection->input + connection->start;
+        size_t unread = connection->length - connection->start;
+        char *newline = memchr(line, '\n', unread);
+
+        if (newline == NULL) {
+            if (unread > SERVER_MAX_REQUEST) {
+                add_text(reply, "error: Too long request\n");
+                connection->reading_closed = true;
+                connection->start = connection->length;
+            } else if (connection->reading_closed) {
+                expr_session_answer(session, line, unread, reply);
+                connection->start = connection->length;
+                num_of_requests++;
+            }
+            break;
+        }
+        expr_session_answer(session, line, newline - line, reply);
+        connection->start += newline - line + 1;
+        num_of_requests++;
+    }
+    return num_of_requests;
+}
+
+// Writes what the connection had left to receive and its answers of the
+// batch with one `writev`, and keeps what doesn't fit for later.
+
+static void send_answers(Connection *connection, const ReplyBuffer *reply) {
+    struct iovec parts[2];
+    int num_of_parts = 0;
+    size_t batch_length = connection->batch_end - connection->batch_start;
+    size_t total = connection->pending_length + batch_length;
+
+    if (connection->pending_length > 0)
+        parts[num_of_parts++] = (struct iovec){ connection->pending, connection->pending_length };
+    if (batch_length > 0)
+        parts[num_of_parts++] = (struct iovec){ reply->data + connection->batch_start, batch_length };
+    if (num_of_parts == 0 || connection->failed) return;
+
+    ssize_t written;
+    do {
+        written = writev(connection->fd, parts, num_of_parts);
+    } while (written < 0 && errno == EINTR);
+    if (written < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            connection->failed = true;
+            return;
+        }
+        written = 0;
+    }
+
+    // What's left is the end of the pending answers, then the end of the
+    // answers of the batch.
+    size_t left = total - written;
+    size_t from_pending = written < (ssize_t)connection->pending_length ? connection->pending_length - written : 0;
+    if (from_pending > 0)
+        memmove(connection->pending, connection->pending + connection->pending_length - from_pending, from_pending);
+    if (left > connection->pending_capacity) {
+        connection->pending_capacity = 2 * left;
+        connection->pending = grow(connection->pending, connection->pending_capacity);
+    }
+    memcpy(
+        connection->pending + from_pending,
+        reply->data + connection->batch_end - (left - from_pending), left - from_pending
+    );
+    connection->pending_length = left;
+}
+
+bool expr_serve(const char *path, size_t memory_budget, ServerStats *stats) {
+    struct sockaddr_un address;
+    memset(stats, 0, sizeof(ServerStats));
+    if (!make_address(&address, path) || !remove_stale_socket(path, &address)) return false;
+
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (
+        listener < 0 ||
+        bind(listener, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+        listen(listener, SOMAXCONN) < 0
+    ) {
+        perror("[Error] : Can't listen in <function:expr_serve>");
+        if (listener >= 0) close(listener);
+        return false;
+    }
+
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL };
+    if (epoll < 0 || epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event) < 0) {
+        perror("[Error] : epoll failed in <function:expr_serve>");
+        close(listener);
+        unlink(path);
+        return false;
+    }
+
+    // SIGINT and SIGTERM stay blocked but while `epoll_pwait` waits, so that
+    // one that comes after `stopping` is checked still interrupts the wait
+    // instead of being noticed at the next event only.
+    struct sigaction action = { .sa_handler = stop };
+    sigset_t stop_signals, old_mask, wait_mask;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &stop_signals, &old_mask);
+    wait_mask = old_mask;
+    sigdelset(&wait_mask, SIGINT);
+    sigdelset(&wait_mask, SIGTERM);
+
+    Session session;
+    ReplyBuffer reply = { .data = NULL };
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    expr_session_init(&session, memory_budget);
+
+    while (!stopping) {
+        int num_of_events = epoll_pwait(epoll, events, SERVER_MAX_EVENTS, -1, &wait_mask);
+        if (num_of_events < 0) {
+            if (errno == EINTR) continue;
+            perror("[Error] : epoll_pwait failed in <function:expr_serve>");
+            break;
+        }
+
+        Connection *batch = NULL;
+        for (int e = 0; e < num_of_events; ++e) {
+            Connection *connection = events[e].data.ptr;
+
+            if (connection == NULL) {
+                accept_connections(epoll, listener, stats);
+                continue;
+            }
+            if (events[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                if (connection->interest & EPOLLIN) {
+                    read_requests(connection);
+                } else if (events[e].events & (EPOLLHUP | EPOLLERR)) {
+                    connection->failed = true;
+                }
+            }
+            if (!connection->in_batch) {
+                connection->in_batch = true;
+                connection->next_in_batch = batch;
+                batch = connection;
+            }
+        }
+
+        long num_of_requests = 0;
+        reply.length = 0;
+        for (Connection *connection = batch; connection != NULL; connection = connection->next_in_batch) {
+            connection->batch_start = reply.length;
+            if (!connection->failed) num_of_requests += answer_requests(&session, connection, &reply);
+            connection->batch_end = reply.length;
+        }
+        if (num_of_requests > 0) {
+            stats->num_of_batches++;
+            stats->num_of_requests += num_of_requests;
+            if (num_of_requests > stats->largest_batch) stats->largest_batch = num_of_requests;
+        }
+
+        Connection *connection = batch;
+        while (connection != NULL) {
+            Connection *next = connection->next_in_batch;
+
+            connection->in_batch = false;
+            send_answers(connection, &reply);
+            if (connection->failed || (connection->reading_closed && connection->pending_length == 0)) {
+                close_connection(epoll, connection);
+            } else {
+                watch(epoll, connection);
+            }
+            connection = next;
+        }
+    }
+
+    // The connections still open are only closed with the process: epoll
+    // doesn't list them, and the answers they wait for are lost anyway.
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+    expr_session_free(&session);
+    expr_reply_free(&reply);
+    close(epoll);
+    close(listener);
+    unlink(path);
+    return true;
+}
+
+static bool write_all(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        length -= written;
+    }
+    return true;
+}
+
+bool expr_client(const char *path, int in, int out) {
+    struct sockaddr_un address;
+    if (!make_address(&address, path)) return false;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        perror("[Error] : Can't connect in <function:expr_client>");
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    signal(SIGPIPE, SIG_IGN);
+
+    char *requests = malloc(SERVER_READ_SIZE), *answers = malloc(SERVER_READ_SIZE);
+    size_t start = 0, length = 0;
+    bool is_open = true, has_shut = false, succeeded = true;
+    if (requests == NULL || answers == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:expr_client>\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // The requests are read only when the last ones are all sent, and the
+    // answers are always read, so neither side waits for the other.
+    while (true) {
+        struct pollfd fds[2] = {
+            { .fd = fd, .events = POLLIN | (start < length ? POLLOUT : 0) },
+            { .fd = is_open && start == length ? in : -1, .events = POLLIN }
+        };
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            succeeded = false;
+            break;
+        }
+
+        if (fds[1].revents & (POLLIN | POLLHUP | POLLERR)) {
+            ssize_t count = read(in, requests, SERVER_READ_SIZE);
+            if (count > 0) {
+                start = 0;
+                length = count;
+            } else if (count == 0 || errno != EINTR) {
+                is_open = false;
+            }
+        }
+        if (fds[0].revents & POLLOUT) {
+            ssize_t written = write(fd, requests + start, length - start);
+            if (written > 0) {
+                start += written;
+            } else if (written < 0 && errno != EAGAIN && errno != EINTR) {
+                // The server stopped reading (after a too long request): the
+                // rest isn't sent, but its answers still are read.
+                start = length;
+                is_open = false;
+                has_shut = true;
+            }
+        }
+        if (!is_open && start == length && !has_shut) {
+            shutdown(fd, SHUT_WR);
+            has_shut = true;
+        }
+        if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            ssize_t count = read(fd, answers, SERVER_READ_SIZE);
+            if (count > 0) {
+                if (!write_all(out, answers, count)) {
+                    succeeded = false;
+                    break;
+                }
+            } else if (count == 0) {
+                break;
+            } else if (errno != EAGAIN && errno != EINTR) {
+                succeeded = false;
+                break;
+            }
+        }
+    }
+
+    if (!succeeded) perror("[Error] : The connection failed in <function:expr_client>");
+    free(requests);
+    free(answers);
+    close(fd);
+    return succeeded;
+}
@@ -0,0 +1,54 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Answers the requests of `session.h` for every client connected to a UNIX
+// domain socket, from a single thread, so that a program that needs a value
+// sends one line to a process that's already running, instead of starting
+// one, which takes thousands of times longer:
+//
+//   [+] The socket and the connections are watched by epoll, and none of
+//       them ever blocks: a connection is read or written only when it can
+//       be;
+//   [+] Whatever epoll reports at once is one batch: everything the clients
+//       have sent is read first, then all their whole requests are answered
+//       in one pass over a single session (and its cache), into one buffer;
+//   [+] Then each connection gets its answers of the batch, after what it
+//       had left to receive, with one `writev`. A client that doesn't read
+//       its answers isn't read from until it does.
+
+#define SERVER_MAX_EVENTS 256
+#define SERVER_READ_SIZE (1 << 16)
+#define SERVER_MAX_REQUEST (1 << 20)    // ← The longest request, and the most answers left to send.
+
+typedef struct {
+    long num_of_connections;
+    long num_of_batches;
+    long num_of_requests;
+    long largest_batch;     // ← The most requests answered in one batch.
+} ServerStats;
+
+/*!
+ * @param [in] [path] The path of the socket, removed at the end. Only the
+ * socket of a daemon that's gone may already be there.
+ * @param [in] [memory_budget] The bytes the cache of compiled expressions may
+ * hold.
+ * @param [out] [stats] What was answered.
+ * @remark Answers requests until SIGINT or SIGTERM. Returns false if the
+ * socket can't be made.
+ */
+bool expr_serve(const char *path, size_t memory_budget, ServerStats *stats);
+
+/*!
+ * @param [in] [path] The path of the socket of `expr_serve`.
+ * @param [in] [in] Where the requests are read from, until its end.
+ * @param [in] [out] Where the answers are written.
+ * @remark Sends the requests and writes the answers as they come, both at
+ * once, so that any number of them can be sent. Returns false if the server
+ * can't be reached or the connection fails.
+ */
+bool expr_client(const char *path, int in, int out);
+
+#endif
@@ -0,0 +1,147 @@
+#include "session.h"
+#include "../../common/number.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The longest answer: the counters of ":stats", or "error: " and an error
+// of the cache.
+#define MAX_ANSWER 256
+
+static void* allocate(size_t size) {
+    void *memory = malloc(size);
+    if (memory == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:expr_session_answer>\n");
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+void expr_session_init(Session *session, size_t memory_budget) {
+    memset(session, 0, sizeof(Session));
+    expr_cache_init(&session->cache, memory_budget);
+}
+
+void expr_session_free(Session *session) {
+    expr_cache_free(&session->cache);
+    free(session->values);
+    free(session->is_set);
+    session->values = NULL;
+    session->is_set = NULL;
+    session->capacity = 0;
+}
+
+void expr_reply_free(ReplyBuffer *reply) {
+    free(reply->data);
+    reply->data = NULL;
+    reply->length = 0;
+    reply->capacity = 0;
+}
+
+// Makes room for an answer at the end of `reply`, returns where it goes.
+
+static char* reserve(ReplyBuffer *reply) {
+    if (reply->capacity - reply->length < MAX_ANSWER) {
+        size_t capacity = reply->capacity > 0 ? 2 * reply->capacity : 4096;
+        char *data = realloc(reply->data, capacity);
+        if (data == NULL) {
+            fprintf(stderr, "[Error] : realloc failed in <function:reserve>\n");
+            exit(EXIT_FAILURE);
+        }
+        reply->data = data;
+        reply->capacity = capacity;
+    }
+    return reply->data + reply->length;
+}
+
+// Reads "name = value" pairs separated by commas, for the variables of
+// `program`. Others are ignored, like the columns of -e.
+
+static const char* read_bindings(Session *session, const Program *program, const char *p, const char *end) {
+    int num_of_variables = program->num_of_variables;
+
+    if (num_of_variables > session->capacity) {
+        session->capacity = 2 * num_of_variables;
+        free(session->values);
+        free(session->is_set);
+        session->values = allocate(session->capacity * sizeof(double));
+        session->is_set = allocate(session->capacity * sizeof(bool));
+    }
+    memset(session->is_set, 0, num_of_variables * sizeof(bool));
+
+    while (true) {
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        if (p == end) break;
+
+        char name[EXPR_MAX_NAME];
+        int length = 0;
+        while (p < end && (isalnum((unsigned char)*p) || *p == '_')) {
+            if (length == EXPR_MAX_NAME - 1) return "Too long name of a variable";
+            name[length++] = *p++;
+        }
+        name[length] = '\0';
+        if (length == 0) return "Expected the name of a variable";
+
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        if (p == end || *p != '=') return "Expected = after the name of a variable";
+        p++;
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+
+        double value;
+        const char *stop = number_parse(p, end, &value);
+        if (stop == p) return "Expected the value of a variable";
+        p = stop;
+
+        int v = expr_variable(program, name);
+        if (v >= 0) {
+            session->values[v] = value;
+            session->is_set[v] = true;
+        }
+
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        if (p < end && *p != ',') return "Expected , between the values";
+        if (p < end) p++;
+    }
+
+    for (int v = 0; v < num_of_variables; ++v) {
+        if (!session->is_set[v]) return "Lack the value of a variable";
+    }
+    return NULL;
+}
+
+void expr_session_answer(Session *session, const char *line, size_t length, ReplyBuffer *reply) {
+    const char *end = line + length;
+    ExprCache *cache = &session->cache;
+    char *out = reserve(reply);
+
+    session->num_of_requests++;
+    if (length > 0 && end[-1] == '\r') end--;
+    if (end - line == 6 && memcmp(line, ":stats", 6) == 0) {
+        reply->length += snprintf(
+            out, MAX_ANSWER, "hits %ld, misses %ld, evictions %ld, entries %ld, memory %zu of %zu bytes\n",
+            cache->hits, cache->misses, cache->evictions, cache->num_of_entries,
+            cache->memory_used, cache->memory_budget
+        );
+        return;
+    }
+
+    const char *semicolon = memchr(line, ';', end - line);
+    const char *source_end = semicolon != NULL ? semicolon : end;
+    const JitProgram *jit = expr_cache_get(cache, line, source_end - line);
+    if (jit == NULL) {
+        reply->length += snprintf(out, MAX_ANSWER, "error: %s\n", cache->error);
+        return;
+    }
+
+    const char *problem = read_bindings(session, jit->program, semicolon != NULL ? semicolon + 1 : end, end);
+    if (problem != NULL) {
+        reply->length += snprintf(out, MAX_ANSWER, "error: %s\n", problem);
+        return;
+    }
+
+    double result;
+    if (expr_jit_evaluate(jit, session->values, &result) == EXPR_DIVISION_BY_ZERO)
+        fprintf(stderr, "[Error] : Division by zero in request %ld\n", session->num_of_requests);
+    reply->length += snprintf(out, MAX_ANSWER, "%.17g\n", result);
+}
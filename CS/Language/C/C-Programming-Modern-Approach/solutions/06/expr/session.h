@@ -0,0 +1,56 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "cache.h"
+
+// Answers requests, one per line, with the expressions compiled last kept in
+// a cache (see `cache.h`). A request is an expression, then ';' and the
+// values of its variables:
+//
+//   x * (y + 1); x = 1, y = 2
+//
+// and its answer is a line with the value, 3, or "error: " and why there's
+// none. The request ":stats" is answered with the counters of the cache.
+// The answers are added to a buffer, to be written out together.
+
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} ReplyBuffer;
+
+typedef struct {
+    ExprCache cache;
+    double *values;         // ← The values of the variables of a request.
+    bool *is_set;
+    int capacity;
+    long num_of_requests;
+} Session;
+
+/*!
+ * @param [out] [session] A session with an empty cache of `memory_budget`
+ * bytes.
+ */
+void expr_session_init(Session *session, size_t memory_budget);
+
+/*!
+ * @remark Releases the session and its cache.
+ */
+void expr_session_free(Session *session);
+
+/*!
+ * @param [in] [line] The request, `length` characters long, without its '\n'.
+ * @param [out] [reply] Where its answer is added, with its '\n'.
+ * @remark A division by zero gives 0, as in `expr_evaluate`, and it's reported
+ * on stderr with the number of the request in the session.
+ */
+void expr_session_answer(Session *session, const char *line, size_t length, ReplyBuffer *reply);
+
+/*!
+ * @remark Releases the memory of `reply`.
+ */
+void expr_reply_free(ReplyBuffer *reply);
+
+#endif
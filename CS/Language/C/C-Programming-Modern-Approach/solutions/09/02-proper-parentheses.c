@@ -1,63 +1,45 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include "../common/stack.h"
 
-typedef struct StackNode {
-    char content;
-    struct StackNode *next;
-} StackNode;
+// The open parentheses and braces are kept in a stack of `stack.h`, which
+// holds the first 64 of them without allocating anything.
 
-typedef struct Stack {
-    StackNode *top;
-} Stack;
-
-Stack* init_stack(void) {
-    Stack *stack = (Stack*)malloc(sizeof(Stack));
-    stack->top = NULL;
-    return stack;
-}
-
-void push(Stack *stack, char new_content) {
-    StackNode *node = (StackNode*)malloc(sizeof(StackNode));
-    node->content = new_content;
-    node->next = stack->top;
-    stack->top = node;
-}
-
-char pop(Stack *stack) {
-    char temp = stack->top->content;
-    stack->top = stack->top->next;
-    return temp;
-}
-
-char get_top(Stack *stack) {
-    return stack->top->content;
-}
+STACK_DEFINE(Stack, stack, char, 64)
 
 int main(void) {
-    Stack *parentheses = init_stack();
-    char input;
+    Stack stack;
+    Stack *parentheses = &stack;
+    int input;
     bool valid = true;
 
     printf("Enter the parentheses and/or braces: ");
-    while ((input = getchar()) != '\n') {
+    stack_init(parentheses);
+    while ((input = getchar()) != '\n' && input != EOF) {
         switch (input) {
             case '(' : case '[' : case '{' :
-                push(parentheses, input);
+                stack_push(parentheses, input);
                 break;
             case ')' : case ']' : case '}' :
                 if (
-                    get_top(parentheses) == '(' && input == ')' ||
-                    get_top(parentheses) == '[' && input == ']' ||
-                    get_top(parentheses) == '{' && input == '}'
+                    !stack_is_empty(parentheses) && (
+                        (stack_top(parentheses) == '(' && input == ')') ||
+                        (stack_top(parentheses) == '[' && input == ']') ||
+                        (stack_top(parentheses) == '{' && input == '}')
+                    )
                 ) {
-                    (void) pop(parentheses);
+                    (void) stack_pop(parentheses);
                 } else {
                     valid = false;
                 }
         }
     }
 
+    // Parentheses still open at the end are not closed properly either.
+    if (!stack_is_empty(parentheses)) valid = false;
+
     printf("Parentheses/braces are %snested properly", valid ? "" : "not ");
+    stack_free(parentheses);
     return 0;
 }
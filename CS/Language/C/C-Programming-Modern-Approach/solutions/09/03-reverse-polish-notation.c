@@ -1,8 +1,14 @@
+#include <errno.h>
+#include <fcntl.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../common/number.h"
+#include "../common/stack.h"
 
 // Because it's reverse polish notation so it doesn't need an operation stack,
 // when encountering the operations, we only need to get two operands from
@@ -15,51 +21,38 @@ void print_repeated(char* repeated, int times) {
     printf("\n");
 }
 
-typedef struct StackNode {
-    double num;
-    struct StackNode *next;
-} StackNode;
+// The numbers are kept in a stack of `stack.h`, which holds the first 32 of
+// them without allocating anything.
 
-typedef struct Stack {
-    StackNode *top;
-} Stack;
-
-Stack* init_stack(void) {
-    Stack *stack = (Stack*)malloc(sizeof(Stack));
-    stack->top = NULL;
-    return stack;
-}
+STACK_DEFINE(Stack, stack, double, 32)
 
 bool is_empty(Stack *stack) {
-    return stack->top == NULL;
+    return stack_is_empty(stack);
 }
 
 void push_num(Stack *stack, double new) {
-    StackNode *node = (StackNode*)malloc(sizeof(StackNode));
-    node->next = stack->top;
-    node->num = new;
-    stack->top = node;
+    stack_push(stack, new);
 }
 
 double pop_num(Stack *stack) {
     if (is_empty(stack)) return 0.0;
-
-    double temp = stack->top->num;
-    stack->top = stack->top->next;
-    return temp;
+    return stack_pop(stack);
 }
 
 void print_stack_num(Stack *stack) {
-    StackNode *read = stack->top;
-
-    while (read != NULL) {
-        printf("%lf ", read->num);
-        read = read->next;
+    for (int i = stack->length - 1; i >= 0; --i) {
+        printf("%lf ", stack->items[i]);
     }
     printf("]");
 }
 
+// The stack is only shown after every step with -t.
+
+static bool trace = false;
+
 void print_stack_state(Stack *num_stack) {
+    if (!trace) return;
+
     print_repeated("\n", 0);
     printf("\n");
     printf("→ Number Stack:    ");
@@ -74,9 +67,12 @@ bool is_op(char check) {
         check == '/';
 }
 
+// The digits are read by `number_parse` (see `common/number.h`), which
+// rounds the number once to the nearest double, like `strtod`, and also
+// reads exponents like 1.5e-3.
+
 double parse_num(char *input, int *index) {
-    double num = 0.0, scale = 1.0;
-    bool has_met_dot;
+    double num = 0.0;
 
     if (
         input[*index] == '-' &&
@@ -87,25 +83,10 @@ double parse_num(char *input, int *index) {
         return num;
     }
 
-    while (
-        input[*index] != '\0' &&
-        (isdigit(input[*index]) || input[*index] == '.')
-    ) {
-        if (input[*index] == '.') {
-            has_met_dot = true;
-            (*index)++;
-            continue;
-        }
-
-        if (has_met_dot) {
-            scale *= 0.1;
-            num += (input[*index] - '0') * scale;
-        } else {
-            num = num * 10 + (input[*index] - '0');
-        }
-
-        (*index)++;
-    }
+    const char *start = input + *index;
+    const char *end = number_parse(start, start + strlen(start), &num);
+    if (end == start) end++;        // ← A lone '.' is 0.
+    *index = end - input;
 
     return num;
 }
@@ -126,7 +107,10 @@ double calculate(double a, double b, char op) {
 }
 
 double evaluate_rpn_expression(char expr[]) {
-    Stack *num_stack = init_stack();
+    Stack stack;
+    Stack *num_stack = &stack;
+
+    stack_init(num_stack);
 
     int len = strlen(expr);
     int i = 0;
@@ -157,19 +141,242 @@ double evaluate_rpn_expression(char expr[]) {
     if (!is_empty(num_stack)) {
         printf("[Error] : Not enough operators in expressions.\n");
     }
+    stack_free(num_stack);
     return res;
 }
 
-int main(void) {
-    char expression[100];
+// With -b, every line of the input is an RPN expression of its own, and
+// its value is written on a line of the output. Lines of any length are read
+// from a large buffer refilled with `read`, the values are written through a
+// large buffer of stdout, and the number of lines per second is reported on
+// stderr at the end.
+
+#define READ_BUFFER_SIZE (1 << 20)
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+typedef struct {
+    int fd;
+    char *buffer;
+    size_t capacity;
+    size_t start;       // ← The unread input is buffer[start] to buffer[length - 1].
+    size_t length;
+    bool reached_eof;
+} LineReader;
+
+// Returns the next line, without its '\n', and sets its length, or returns
+// NULL at the end of the input. The line stays valid until the next call.
+
+static const char* next_line(LineReader *reader, size_t *line_length) {
+    while (true) {
+        char *begin = reader->buffer + reader->start;
+        size_t unread = reader->length - reader->start;
+        char *newline = memchr(begin, '\n', unread);
+
+        if (newline != NULL) {
+            *line_length = newline - begin;
+            reader->start += *line_length + 1;
+            return begin;
+        }
+        if (reader->reached_eof) {
+            if (unread == 0) return NULL;
+            *line_length = unread;
+            reader->start = reader->length;
+            return begin;
+        }
+
+        // The line goes on after the buffer: keep its beginning and read more,
+        // in a larger buffer if it already fills the whole one.
+        memmove(reader->buffer, begin, unread);
+        reader->start = 0;
+        reader->length = unread;
+        if (reader->length == reader->capacity) {
+            char *larger = (char*)realloc(reader->buffer, reader->capacity * 2);
+            if (larger == NULL) {
+                fprintf(stderr, "[Error] : realloc failed in <function:next_line>\n");
+                exit(EXIT_FAILURE);
+            }
+            reader->buffer = larger;
+            reader->capacity *= 2;
+        }
+
+        ssize_t count = read(reader->fd, reader->buffer + reader->length, reader->capacity - reader->length);
+        if (count > 0) {
+            reader->length += count;
+        } else if (count < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (count < 0) perror("[Error] : read failed in <function:next_line>");
+            reader->reached_eof = true;
+        }
+    }
+}
+
+typedef enum {
+    RPN_OK,
+    RPN_EMPTY,
+    RPN_DIVISION_BY_ZERO,
+    RPN_INVALID,
+    RPN_TOO_FEW_OPERANDS,
+    RPN_TOO_MANY_OPERANDS
+} RpnStatus;
+
+// Evaluates the expression from `p` to `end`. A number may have a sign when
+// it's written right before its digits ("3 -2 +" is 1), a lone sign is an
+// operation.
+
+static RpnStatus evaluate_line(const char *p, const char *end, Stack *num_stack, double *result) {
+    RpnStatus status = RPN_OK;
+
+    stack_clear(num_stack);
+    while (true) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+        if (p == end) break;
+
+        bool is_signed = (*p == '-' || *p == '+') && end - p > 1 && (isdigit((unsigned char)p[1]) || p[1] == '.');
+        if (isdigit((unsigned char)*p) || *p == '.' || is_signed) {
+            double num;
+            const char *stop = number_parse(p, end, &num);
+            if (stop == p) return RPN_INVALID;
+            p = stop;
+            push_num(num_stack, num);
+        } else if (is_op(*p)) {
+            if (num_stack->length < 2) return RPN_TOO_FEW_OPERANDS;
+            double a = stack_pop(num_stack);
+            double b = stack_pop(num_stack);
+            if (*p == '/' && a == 0.0) {
+                status = RPN_DIVISION_BY_ZERO;
+                push_num(num_stack, 0.0);
+            } else {
+                push_num(num_stack, calculate(b, a, *p));
+            }
+            p++;
+        } else {
+            return RPN_INVALID;
+        }
+        print_stack_state(num_stack);
+    }
+
+    if (num_stack->length == 0) return RPN_EMPTY;
+    if (num_stack->length > 1) return RPN_TOO_MANY_OPERANDS;
+    *result = stack_top(num_stack);
+    return status;
+}
+
+static double seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static int evaluate_lines(int fd) {
+    LineReader reader = { .fd = fd, .capacity = READ_BUFFER_SIZE };
+    Stack stack;
+    const char *line;
+    size_t length;
+    long line_number = 0, num_of_lines = 0, num_of_errors = 0;
+    double start = seconds();
+
+    reader.buffer = (char*)malloc(reader.capacity);
+    if (reader.buffer == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:evaluate_lines>\n");
+        exit(EXIT_FAILURE);
+    }
+    stack_init(&stack);
+    setvbuf(stdout, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+
+    while ((line = next_line(&reader, &length)) != NULL) {
+        double result = 0.0;
+        line_number++;
+
+        RpnStatus status = evaluate_line(line, line + length, &stack, &result);
+        if (status == RPN_EMPTY) continue;
+        num_of_lines++;
+
+        switch (status) {
+            case RPN_OK : break;
+            case RPN_DIVISION_BY_ZERO :
+                fprintf(stderr, "[Error] : Division by zero in line %ld\n", line_number);
+                break;
+            case RPN_TOO_FEW_OPERANDS :
+                fprintf(stderr, "[Error] : Not enough numbers in line %ld\n", line_number);
+                break;
+            case RPN_TOO_MANY_OPERANDS :
+                fprintf(stderr, "[Error] : Not enough operators in line %ld\n", line_number);
+                break;
+            default :
+                fprintf(stderr, "[Error] : Invalid expression in line %ld\n", line_number);
+                break;
+        }
+
+        if (status == RPN_OK || status == RPN_DIVISION_BY_ZERO) {
+            printf("%.17g\n", result);
+        } else {
+            printf("nan\n");
+            num_of_errors++;
+        }
+    }
+    fflush(stdout);
+
+    double elapsed = seconds() - start;
+    fprintf(
+        stderr, "[Info] : %ld lines in %.3f s, %.0f lines/s, %ld invalid\n",
+        num_of_lines, elapsed, elapsed > 0 ? num_of_lines / elapsed : 0.0, num_of_errors
+    );
+
+    stack_free(&stack);
+    free(reader.buffer);
+    return num_of_errors > 0 ? 1 : 0;
+}
+
+// Usage: 03-reverse-polish-notation [-t]
+//        03-reverse-polish-notation -b [-t] [file]
+//
+// Without -b, reads one expression per line from the keyboard and writes its
+// value, until the end of the input.
+//
+//   -b   Evaluates every line of the file (or of the standard input) as
+//        above, writing only the values, one per line, with all 17 digits.
+//        A line that can't be evaluated gives "nan" and a message on stderr.
+//   -t   Shows the stack after every number and operation.
+
+int main(int argc, char *argv[]) {
+    bool batch = false;
+    int option;
+
+    while ((option = getopt(argc, argv, "bt")) != -1) {
+        switch (option) {
+            case 'b' : batch = true; break;
+            case 't' : trace = true; break;
+            default  :
+                fprintf(stderr, "Usage: %s [-t]\n       %s -b [-t] [file]\n", argv[0], argv[0]);
+                return 1;
+        }
+    }
+
+    if (batch) {
+        int fd = STDIN_FILENO;
+        if (optind < argc && (fd = open(argv[optind], O_RDONLY)) < 0) {
+            perror("[Error] : open failed in <function:main>");
+            return 1;
+        }
+        int status = evaluate_lines(fd);
+        if (fd != STDIN_FILENO) close(fd);
+        return status;
+    }
+
+    char *expression = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+
     while (true) {
         printf("Enter an RPN expression: ");
-        scanf("%[^\n]", expression);
+        fflush(stdout);
+        if ((length = getline(&expression, &capacity, stdin)) < 0) break;
+        if (length > 0 && expression[length - 1] == '\n') expression[length - 1] = '\0';
         printf("Value of expression: %f\n", evaluate_rpn_expression(expression));
-
-        char input;
-        while ((input = getchar()) != '\n');
     }
 
+    printf("\n");
+    free(expression);
     return 0;
 }
@@ -0,0 +1,463 @@
+#include "batch.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "log.h"
+#include "uring.h"
+
+// Running `justify` once per file costs a new process, a new log and new
+// buffers for every file, which for small files is most of the work. Here
+// one process justifies all of them: each thread of the pool takes the next
+// files of the list, with a context of its own that's reused for every file.
+//
+// A thread keeps the reads of its next PREFETCH_FILES files in flight while
+// it justifies the current one, with io_uring when the kernel allows it, so
+// the disk and the processor work at the same time. Without io_uring (or with
+// JUSTIFY_IO=pread) each file is read with `pread` when its turn comes.
+
+#define PREFETCH_FILES 4
+#define MAX_READ (1u << 30)
+
+typedef struct {
+    const char *path;
+    const char *failed_at;  // ← What failed, or NULL.
+    int error;
+    size_t input_size;
+    size_t output_size;
+} FileResult;
+
+// A file being read, in the queue of a worker.
+
+typedef struct {
+    int index;
+    int fd;
+    char *data;
+    size_t capacity;
+    size_t size;
+    size_t done;
+    bool complete;
+    bool submitted;
+} Pending;
+
+static char **paths = NULL;
+static FileResult *results = NULL;
+static int num_of_files = 0;
+static int next_file = 0;
+
+static const JustifyOptions *batch_options = NULL;
+static const char *batch_output_directory = NULL;
+static bool use_uring = true;
+
+static void add_path(const char *path, size_t length, int *capacity) {
+    if (num_of_files == *capacity) {
+        *capacity = *capacity > 0 ? *capacity * 2 : 1024;
+        paths = (char**)realloc(paths, *capacity * sizeof(char*));
+        if (paths == NULL) {
+            fprintf(stderr, "[Error] : realloc failed in <function:add_path>\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    paths[num_of_files] = (char*)malloc(length + 1);
+    if (paths[num_of_files] == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:add_path>\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(paths[num_of_files], path, length);
+    paths[num_of_files][length] = '\0';
+    num_of_files++;
+}
+
+static bool is_output(const char *name) {
+    size_t length = strlen(name);
+    return length > 4 && strcmp(name + length - 4, ".out") == 0;
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static const char* base_name(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash == NULL ? path : slash + 1;
+}
+
+static int compare_base_names(const void *a, const void *b) {
+    return strcmp(base_name(*(char* const*)a), base_name(*(char* const*)b));
+}
+
+// With -O every file is written under its name alone, so two inputs of the
+// same name (a/x and b/x) would overwrite each other's output. Reports the
+// first two found and returns false.
+
+static bool check_output_names(const char *output_directory) {
+    char **sorted = (char**)malloc((num_of_files > 0 ? num_of_files : 1) * sizeof(char*));
+    bool unique = true;
+
+    if (sorted == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:check_output_names>\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(sorted, paths, num_of_files * sizeof(char*));
+    qsort(sorted, num_of_files, sizeof(char*), compare_base_names);
+    for (int i = 1; i < num_of_files && unique; ++i) {
+        if (compare_base_names(&sorted[i - 1], &sorted[i]) == 0) {
+            fprintf(
+                stderr, "[Error] : %s and %s would both be written to %s/%s\n",
+                sorted[i - 1], sorted[i], output_directory, base_name(sorted[i])
+            );
+            unique = false;
+        }
+    }
+    free(sorted);
+    return unique;
+}
+
+// Lists the regular files of a directory (not of its subdirectories), sorted
+// by name so that the report is always in the same order. The ".out" files
+// are left out: they're what a run without -O wrote there, and justifying
+// them again would write "x.out.out" next time, and so on.
+
+static bool list_directory(const char *directory) {
+    DIR *stream = opendir(directory);
+    struct dirent *entry;
+    struct stat info;
+    char path[4096];
+    int capacity = 0;
+
+    if (stream == NULL) return false;
+    while ((entry = readdir(stream)) != NULL) {
+        int length = snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+        if (length >= (int)sizeof(path)) continue;
+        if (is_output(entry->d_name)) continue;
+        if (stat(path, &info) != 0 || !S_ISREG(info.st_mode)) continue;
+        add_path(path, length, &capacity);
+    }
+    closedir(stream);
+    qsort(paths, num_of_files, sizeof(char*), compare_paths);
+    return true;
+}
+
+static bool list_file(const char *list) {
+    FILE *stream = strcmp(list, "-") == 0 ? stdin : fopen(list, "r");
+    char *line = NULL;
+    size_t line_capacity = 0;
+    ssize_t length;
+    int capacity = 0;
+
+    if (stream == NULL) return false;
+    while ((length = getline(&line, &line_capacity, stream)) > 0) {
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) length--;
+        if (length > 0) add_path(line, length, &capacity);
+    }
+    free(line);
+    if (stream != stdin) fclose(stream);
+    return true;
+}
+
+static void fail(Pending *pending, const char *failed_at, int error) {
+    FileResult *result = &results[pending->index];
+    if (result->failed_at == NULL) {
+        result->failed_at = failed_at;
+        result->error = error;
+    }
+    pending->complete = true;
+}
+
+// Opens the next file and, with a ring, asks for all of it at once.
+
+static void start_read(Pending *pending, int index, Uring *ring) {
+    struct stat info;
+
+    pending->index = index;
+    pending->size = 0;
+    pending->done = 0;
+    pending->complete = false;
+    pending->submitted = false;
+    results[index].path = paths[index];
+
+    pending->fd = open(paths[index], O_RDONLY);
+    if (pending->fd < 0) {
+        fail(pending, "open", errno);
+        return;
+    }
+    if (fstat(pending->fd, &info) != 0) {
+        fail(pending, "stat", errno);
+        return;
+    }
+    if (S_ISDIR(info.st_mode)) {
+        fail(pending, "open", EISDIR);
+        return;
+    }
+    pending->size = info.st_size;
+    results[index].input_size = pending->size;
+
+    if (pending->size > pending->capacity) {
+        free(pending->data);
+        pending->data = (char*)malloc(pending->size);
+        pending->capacity = pending->data == NULL ? 0 : pending->size;
+        if (pending->data == NULL) {
+            fail(pending, "malloc", ENOMEM);
+            return;
+        }
+    }
+    if (pending->size == 0) {
+        pending->complete = true;
+        return;
+    }
+
+    if (ring != NULL) {
+        size_t length = pending->size < MAX_READ ? pending->size : MAX_READ;
+        pending->submitted = uring_read(
+            ring, pending->fd, pending->data, length, 0, (uint64_t)(uintptr_t)pending
+        );
+    }
+}
+
+static void read_with_pread(Pending *pending) {
+    while (pending->done < pending->size) {
+        ssize_t count = pread(
+            pending->fd, pending->data + pending->done,
+            pending->size - pending->done, pending->done
+        );
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) {
+            fail(pending, "read", errno);
+            return;
+        }
+        if (count == 0) break;      // ← The file became shorter.
+        pending->done += count;
+    }
+    pending->size = pending->done;
+    pending->complete = true;
+}
+
+// Waits until `pending` is read, handling the completions of the other files
+// of the queue on the way. A short read asks for the rest of the file.
+//
+// A kernel older than 5.6 sets up a ring but doesn't know IORING_OP_READ, and
+// some files can't be read through a ring: such a read comes back with
+// EINVAL or EOPNOTSUPP. That isn't the file's fault, so the ring is given up
+// for the next files, and the file is read with `pread` when its turn comes.
+// The reads still in flight are waited for all the same, since the kernel
+// writes into their buffers.
+
+static void finish_read(Pending *pending, Uring *ring, bool *ring_broken) {
+    while (!pending->complete && pending->submitted) {
+        uint64_t user_data;
+        int count;
+
+        if (!uring_wait(ring, &user_data, &count)) {
+            *ring_broken = true;
+            break;
+        }
+        Pending *read = (Pending*)(uintptr_t)user_data;
+        if (count == -EINVAL || count == -EOPNOTSUPP) {
+            *ring_broken = true;
+            read->submitted = false;
+            continue;
+        }
+        if (count < 0) {
+            fail(read, "read", -count);
+            continue;
+        }
+
+        read->done += count;
+        if (count == 0 || read->done == read->size) {
+            read->size = read->done;
+            read->complete = true;
+            continue;
+        }
+        if (*ring_broken) {
+            read->submitted = false;    // ← `pread` reads the rest.
+            continue;
+        }
+        size_t rest = read->size - read->done;
+        read->submitted = uring_read(
+            ring, read->fd, read->data + read->done, rest < MAX_READ ? rest : MAX_READ,
+            read->done, user_data
+        );
+    }
+    if (!pending->complete) read_with_pread(pending);
+}
+
+typedef struct {
+    int fd;
+    int error;
+    size_t written;
+} FileWriter;
+
+static void write_file(const char *data, size_t length, void *user_data) {
+    FileWriter *writer = (FileWriter*)user_data;
+
+    while (length > 0 && writer->error == 0) {
+        ssize_t count = write(writer->fd, data, length);
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) {
+            writer->error = errno;
+            return;
+        }
+        data += count;
+        length -= count;
+        writer->written += count;
+    }
+}
+
+static void justify_file(JustifyContext *context, Pending *pending) {
+    FileResult *result = &results[pending->index];
+    char output_path[4096];
+
+    if (batch_output_directory != NULL) {
+        snprintf(output_path, sizeof(output_path), "%s/%s", batch_output_directory, base_name(result->path));
+    } else {
+        snprintf(output_path, sizeof(output_path), "%s.out", result->path);
+    }
+
+    justify_feed(context, pending->data, pending->size);
+    justify_finish(context);
+
+    FileWriter writer = { .fd = -1, .error = 0, .written = 0 };
+    writer.fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (writer.fd < 0) {
+        writer.error = errno;
+        justify_drain(context, write_file, &writer);    // ← Only to empty it.
+        fail(pending, "create", writer.error);
+        return;
+    }
+    justify_drain(context, write_file, &writer);
+    if (close(writer.fd) != 0 && writer.error == 0) writer.error = errno;
+
+    if (writer.error != 0) fail(pending, "write", writer.error);
+    result->output_size = writer.written;
+}
+
+static void* batch_worker(void *argument) {
+    Pending queue[PREFETCH_FILES];
+    int head = 0, count = 0;
+    Uring ring;
+    bool has_ring = use_uring && uring_init(&ring, PREFETCH_FILES);
+    bool ring_broken = false;
+    JustifyContext *context = justify_create(batch_options);
+
+    (void)argument;
+    if (context == NULL) {
+        fprintf(stderr, "[Error] : Not enough memory to justify\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(queue, 0, sizeof(queue));
+
+    while (true) {
+        while (count < PREFETCH_FILES) {
+            int index = __atomic_fetch_add(&next_file, 1, __ATOMIC_RELAXED);
+            if (index >= num_of_files) break;
+
+            Pending *pending = &queue[(head + count) % PREFETCH_FILES];
+            start_read(pending, index, has_ring && !ring_broken ? &ring : NULL);
+            count++;
+        }
+        if (count == 0) break;
+
+        Pending *pending = &queue[head];
+        finish_read(pending, &ring, &ring_broken);
+        if (results[pending->index].failed_at == NULL) justify_file(context, pending);
+        if (pending->fd >= 0) close(pending->fd);
+        pending->fd = -1;
+
+        head = (head + 1) % PREFETCH_FILES;
+        count--;
+    }
+
+    for (int i = 0; i < PREFETCH_FILES; ++i) free(queue[i].data);
+    justify_destroy(context);
+    if (has_ring) uring_exit(&ring);
+    return NULL;
+}
+
+static double seconds_since(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int justify_batch(
+    const char *input, const char *output_directory,
+    const JustifyOptions *options, int num_of_threads
+) {
+    struct stat info;
+    struct timespec start;
+    const char *io = getenv("JUSTIFY_IO");
+    bool listed;
+
+    if (stat(input, &info) == 0 && S_ISDIR(info.st_mode))
+        listed = list_directory(input);
+    else
+        listed = list_file(input);
+    if (!listed) {
+        fprintf(stderr, "[Error] : Can't read the list of files %s: %s\n", input, strerror(errno));
+        return 1;
+    }
+    if (output_directory != NULL && !check_output_names(output_directory)) {
+        for (int i = 0; i < num_of_files; ++i) free(paths[i]);
+        free(paths);
+        paths = NULL;
+        num_of_files = 0;
+        return 1;
+    }
+
+    results = (FileResult*)calloc(num_of_files > 0 ? num_of_files : 1, sizeof(FileResult));
+    pthread_t *threads = (pthread_t*)malloc(num_of_threads * sizeof(pthread_t));
+    if (results == NULL || threads == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:justify_batch>\n");
+        exit(EXIT_FAILURE);
+    }
+    batch_options = options;
+    batch_output_directory = output_directory;
+    use_uring = io == NULL || strcmp(io, "pread") != 0;
+    next_file = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < num_of_threads; ++i) {
+        if (pthread_create(&threads[i], NULL, batch_worker, NULL) != 0) {
+            fprintf(stderr, "[Error] : pthread_create failed in <function:justify_batch>\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = 0; i < num_of_threads; ++i)
+        pthread_join(threads[i], NULL);
+    double elapsed = seconds_since(&start);
+
+    int num_of_failures = 0;
+    size_t total = 0;
+    for (int i = 0; i < num_of_files; ++i) {
+        FileResult *result = &results[i];
+
+        if (result->failed_at != NULL) {
+            num_of_failures++;
+            printf("%s: %s failed: %s\n", result->path, result->failed_at, strerror(result->error));
+            LOG(LOG_ERROR, "%s: %s failed: %s", result->path, result->failed_at, strerror(result->error));
+        } else {
+            printf("%s: %zu bytes -> %zu bytes\n", result->path, result->input_size, result->output_size);
+        }
+        total += result->input_size;
+        free(paths[i]);
+    }
+    fprintf(
+        stderr, "%d files, %d failed, %.1f MB in %.3f s (%.0f files/s)\n",
+        num_of_files, num_of_failures, total / 1e6, elapsed,
+        elapsed > 0 ? num_of_files / elapsed : 0.0
+    );
+
+    free(paths);
+    free(results);
+    free(threads);
+    paths = NULL;
+    results = NULL;
+    num_of_files = 0;
+    return num_of_failures;
+}
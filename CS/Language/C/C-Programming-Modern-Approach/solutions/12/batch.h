@@ -0,0 +1,24 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "libjustify.h"
+
+/*!
+ * @param [in] [input] A directory, whose regular files are justified (but not
+ * the ".out" ones), or a file listing one path per line ("-" for the standard
+ * input).
+ * @param [in] [output_directory] Where the justified files are written under
+ * the same names, or NULL to write each one next to its input with ".out"
+ * appended. Nothing is justified if two inputs have the same name.
+ * @param [in] [options] How to justify every file.
+ * @param [in] [num_of_threads] The number of files justified at the same time.
+ * @remark Justifies every file on its own, on a pool of threads, and reports
+ * one line per file on the standard output in the order of the input. Returns
+ * the number of files that failed.
+ */
+int justify_batch(
+    const char *input, const char *output_directory,
+    const JustifyOptions *options, int num_of_threads
+);
+
+#endif
@@ -0,0 +1,64 @@
+# Builds the plain, optimized (-O3 -flto) and profile-guided variants of
+# `justify` one after the other and compares their speed on the benchmark
+# corpora of run-bench.sh.
+#
+#   ./bench/compare-builds.sh
+#   SIZES="10M 100M" RUNS=5 ./bench/compare-builds.sh
+#
+# Each time is the best of RUNS runs, and the speed-up is relative to the
+# plain build. The program is left built as `make pgo` builds it.
+
+cd "$(dirname "$0")/.." || exit 1
+
+SIZES=${SIZES:-"10M"}
+DISTRIBUTIONS=${DISTRIBUTIONS:-"english short long"}
+RUNS=${RUNS:-3}
+CORPORA=${CORPORA:-bench/corpora}
+BUILDS="plain optimized pgo"
+
+echo ">> Build the three variants"
+
+make clean > /dev/null
+mkdir -p "$CORPORA" bench/results
+make justify bench/make-corpus > /dev/null || exit 1
+cp justify bench/results/justify-plain
+make optimized > /dev/null || exit 1
+cp justify bench/results/justify-optimized
+make pgo > /dev/null 2>&1 || exit 1
+cp justify bench/results/justify-pgo
+
+best_time() {
+  best=""
+  for run in $(seq "$RUNS"); do
+    start=$(date +%s.%N)
+    "$@" < "$corpus" > /dev/null
+    end=$(date +%s.%N)
+    best=$(echo "$start $end $best" | awk '{ t = $2 - $1; if ($3 == "" || t < $3) print t; else print $3 }')
+  done
+  echo "$best"
+}
+
+for size in $SIZES; do
+  for distribution in $DISTRIBUTIONS; do
+    corpus="$CORPORA/$distribution-$size.txt"
+    if [ ! -f "$corpus" ]; then
+      ./bench/make-corpus "$size" "$distribution" > "$corpus" || exit 1
+    fi
+    bytes=$(wc -c < "$corpus")
+
+    for options in "-l warning" "-o -l warning"; do
+      echo ">> "
+      echo ">> justify $options < $corpus"
+
+      plain=""
+      for build in $BUILDS; do
+        seconds=$(best_time "./bench/results/justify-$build" $options)
+        [ -z "$plain" ] && plain=$seconds
+        echo "$build $seconds $bytes $plain" |
+          awk '{ printf "%-10s %8.3f s %10.1f MB/s %6.2fx\n", $1, $2, $3 / $2 / 1e6, $4 / $2 }'
+      done
+    done
+  done
+done
+
+rm -f a.log
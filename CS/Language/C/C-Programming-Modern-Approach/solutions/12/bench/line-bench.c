@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../line.h"
+#include "../output.h"
+
+// Measures how fast justified lines are written: the way `write_line` used to
+// do it (one `putchar` per character and per padding space) against the line
+// built in the output buffer and written in batches.
+//
+//   make bench
+//   ./bench/line-bench [lines] > /dev/null
+
+#define NUM_OF_SAMPLE_LINES 1024
+
+static Line samples[NUM_OF_SAMPLE_LINES];
+
+static double seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// The line as `add_word` used to build it, with the words joined by spaces.
+
+typedef struct {
+    char text[DEFAULT_LINE_WIDTH + 1];
+    int length;
+    int num_of_words;
+} PlainLine;
+
+static PlainLine plain_samples[NUM_OF_SAMPLE_LINES];
+
+static void write_line_putchar(const PlainLine *line) {
+    int extra_spaces, spaces_to_insert;
+    int num_of_words = line->num_of_words;
+    extra_spaces = DEFAULT_LINE_WIDTH - line->length;
+
+    for (int i = 0; i < line->length; ++i) {
+        if (line->text[i] != ' ')
+            putchar(line->text[i]);
+        else {
+            spaces_to_insert = extra_spaces / (num_of_words - 1);
+            for (int j = 1; j <= spaces_to_insert + 1; ++j)
+                putchar(' ');
+            extra_spaces -= spaces_to_insert;
+            num_of_words--;
+        }
+    }
+    putchar('\n');
+}
+
+// Fills the sample lines with random words, the same way `justify` would.
+
+static void make_samples(Output *output) {
+    char word[16];
+
+    srand(12345);
+    for (int i = 0; i < NUM_OF_SAMPLE_LINES; ++i) {
+        PlainLine *plain = &plain_samples[i];
+
+        line_init(&samples[i], output, DEFAULT_LINE_WIDTH);
+        plain->text[0] = '\0';
+        plain->length = 0;
+        plain->num_of_words = 0;
+        while (1) {
+            int length = 1 + rand() % 10;
+            for (int j = 0; j < length; ++j) word[j] = 'a' + rand() % 26;
+            word[length] = '\0';
+            if (length + 1 > line_space_remaining(&samples[i])) break;
+            line_add_word(&samples[i], word, length);
+
+            if (plain->num_of_words > 0) strcat(plain->text, " ");
+            strcat(plain->text, word);
+            plain->length = strlen(plain->text);
+            plain->num_of_words++;
+        }
+    }
+}
+
+static void report(const char *name, long lines, double elapsed) {
+    double bytes = (double)lines * (DEFAULT_LINE_WIDTH + 1);
+    fprintf(
+        stderr, "%-24s %10.0f lines/s %10.1f MB/s\n",
+        name, lines / elapsed, bytes / elapsed / 1e6
+    );
+}
+
+int main(int argc, char *argv[]) {
+    long lines = argc > 1 ? atol(argv[1]) : 10000000;
+    Output output;
+    double start;
+
+    output_init(&output, STDOUT_FILENO, OUTPUT_FLUSH_SIZE);
+    make_samples(&output);
+
+    start = seconds();
+    for (long i = 0; i < lines; ++i)
+        write_line_putchar(&plain_samples[i % NUM_OF_SAMPLE_LINES]);
+    fflush(stdout);
+    report("putchar (before)", lines, seconds() - start);
+
+    start = seconds();
+    for (long i = 0; i < lines; ++i)
+        line_write(&samples[i % NUM_OF_SAMPLE_LINES]);
+    output_flush(&output);
+    report("output buffer (after)", lines, seconds() - start);
+
+    output_close(&output);
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Writes a deterministic text corpus for the benchmarks to the standard
+// output: the same arguments always give the same bytes.
+//
+//   make-corpus size [distribution] [seed]
+//
+// The size takes a K, M or G suffix (powers of 1024). The distribution is the
+// one word lengths are drawn from:
+//
+//   [+] english: lengths weighted like English prose, with some punctuation;
+//   [+] short:   1 to 3 characters, the most words per byte;
+//   [+] long:    10 to 40 characters, most of them truncated by `justify`;
+//   [+] uniform: 1 to 20 characters with the same probability.
+//
+// Words are separated by spaces, with a newline every few words and a blank
+// line between paragraphs.
+
+#define OUTPUT_SIZE (1 << 20)
+
+static uint64_t state;
+
+static uint64_t next_random(void) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 2685821657736338717ULL;
+}
+
+static int random_below(int n) {
+    return next_random() % n;
+}
+
+// Relative frequency of the lengths 1..15 of words in English text.
+static const int english_weights[] = {
+    3, 17, 21, 16, 11, 8, 7, 6, 4, 3, 2, 1, 1, 1, 1
+};
+
+static int word_length(const char *distribution) {
+    if (strcmp(distribution, "short") == 0) return 1 + random_below(3);
+    if (strcmp(distribution, "long") == 0) return 10 + random_below(31);
+    if (strcmp(distribution, "uniform") == 0) return 1 + random_below(20);
+
+    int total = 0, n = sizeof(english_weights) / sizeof(english_weights[0]);
+    for (int i = 0; i < n; ++i) total += english_weights[i];
+
+    int pick = random_below(total);
+    for (int i = 0; i < n; ++i) {
+        if (pick < english_weights[i]) return i + 1;
+        pick -= english_weights[i];
+    }
+    return n;
+}
+
+static long long parse_size(const char *text) {
+    char *suffix;
+    long long size = strtoll(text, &suffix, 10);
+
+    switch (*suffix) {
+        case 'K' : case 'k' : return size << 10;
+        case 'M' : case 'm' : return size << 20;
+        case 'G' : case 'g' : return size << 30;
+        default  : return size;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s size [english|short|long|uniform] [seed]\n", argv[0]);
+        return 1;
+    }
+
+    long long size = parse_size(argv[1]), written = 0;
+    const char *distribution = argc > 2 ? argv[2] : "english";
+    state = argc > 3 ? strtoull(argv[3], NULL, 10) : 0;
+    state = state * 0x9E3779B97F4A7C15ULL + 88172645463325252ULL;
+
+    char *buffer = (char*)malloc(OUTPUT_SIZE + 64);
+    if (buffer == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:main>\n");
+        return 1;
+    }
+    int length = 0, words_on_line = 0, lines_in_paragraph = 0;
+
+    while (written + length < size) {
+        int n = word_length(distribution);
+        for (int i = 0; i < n; ++i) buffer[length++] = 'a' + random_below(26);
+
+        if (strcmp(distribution, "english") == 0 && random_below(10) == 0)
+            buffer[length++] = ",.;"[random_below(3)];
+
+        if (++words_on_line < 8 + random_below(8)) {
+            buffer[length++] = ' ';
+        } else {
+            buffer[length++] = '\n';
+            words_on_line = 0;
+            if (++lines_in_paragraph > 3 + random_below(10)) {
+                buffer[length++] = '\n';
+                lines_in_paragraph = 0;
+            }
+        }
+
+        if (length >= OUTPUT_SIZE) {
+            if (length > size - written) length = size - written;
+            fwrite(buffer, 1, length, stdout);
+            written += length;
+            length = 0;
+        }
+    }
+
+    if (length > size - written) length = size - written;
+    fwrite(buffer, 1, length, stdout);
+    free(buffer);
+    return 0;
+}
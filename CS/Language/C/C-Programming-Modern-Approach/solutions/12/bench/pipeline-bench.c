@@ -0,0 +1,210 @@
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "../line.h"
+#include "../log.h"
+#include "../output.h"
+#include "../word.h"
+
+// Times the three stages of `justify` separately on a corpus file:
+//
+//   [+] read: finding the words of the input with `next_word`;
+//   [+] line: filling lines with `line_add_word` and writing them with
+//       `line_write` (to /dev/null);
+//   [+] log:  the "Read word" message for every word.
+//
+// The words are handled in batches: a batch is read, then filled into lines,
+// then logged, and the clock is only looked at between stages, so it doesn't
+// disturb what is measured.
+//
+//   pipeline-bench [-L text|async|binary] [-s results] [-b baseline]
+//                  [-t threshold] corpus
+//
+// With -s the words per second of each stage are saved to a file. With -b
+// they are compared to a file saved before, and the program fails if a stage
+// is slower than the baseline by more than the threshold (0.1 = 10 percent).
+
+#define BATCH_WORDS 65536
+#define NUM_OF_STAGES 3
+
+typedef struct {
+    const char *name;
+    double seconds;
+} Stage;
+
+static Stage stages[NUM_OF_STAGES] = { { "read", 0 }, { "line", 0 }, { "log", 0 } };
+
+// A word of `next_word` is only valid until the next call (the input may be
+// read into a buffer that's refilled), so the part of each word the stages
+// use is copied for the batch: lengths[i] is the length of the whole word.
+
+static char copies[BATCH_WORDS][MAX_WORD_LENGTH + 1];
+static const char *spans[BATCH_WORDS];
+static int lengths[BATCH_WORDS];
+
+static double seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void fill_lines(Line *line, int count) {
+    char word[MAX_WORD_LENGTH + 2];
+
+    for (int i = 0; i < count; ++i) {
+        int length = lengths[i] > MAX_WORD_LENGTH + 1 ? MAX_WORD_LENGTH + 1 : lengths[i];
+        memcpy(word, spans[i], length);
+        if (length > MAX_WORD_LENGTH) word[MAX_WORD_LENGTH] = '*';
+
+        if (line->num_of_words > 0 && length + 1 > line_space_remaining(line)) {
+            line_write(line);
+            line_clear(line);
+        }
+        line_add_word(line, word, length);
+    }
+}
+
+static void log_words(int count) {
+    char word[MAX_WORD_LENGTH + 2];
+
+    for (int i = 0; i < count; ++i) {
+        int length = lengths[i] > MAX_WORD_LENGTH + 1 ? MAX_WORD_LENGTH + 1 : lengths[i];
+        memcpy(word, spans[i], length);
+        word[length] = '\0';
+        LOG(LOG_INFO, "Read word \"%s\"", word);
+    }
+}
+
+static bool check_baseline(const char *path, double threshold, long words) {
+    FILE *file = fopen(path, "r");
+    char name[32];
+    double expected;
+    bool passed = true;
+
+    if (file == NULL) {
+        fprintf(stderr, "[Error] : Cannot open the baseline %s\n", path);
+        return false;
+    }
+    while (fscanf(file, "%31s %lf", name, &expected) == 2) {
+        for (int i = 0; i < NUM_OF_STAGES; ++i) {
+            if (strcmp(name, stages[i].name) != 0) continue;
+
+            double measured = words / stages[i].seconds;
+            if (measured < expected * (1 - threshold)) {
+                printf(
+                    "REGRESSION %-5s %12.0f words/s, baseline %12.0f words/s\n",
+                    name, measured, expected
+                );
+                passed = false;
+            }
+        }
+    }
+    fclose(file);
+    return passed;
+}
+
+int main(int argc, char *argv[]) {
+    const char *mode = "text", *save = NULL, *baseline = NULL;
+    double threshold = 0.1;
+    int option;
+
+    while ((option = getopt(argc, argv, "L:s:b:t:")) != -1) {
+        switch (option) {
+            case 'L' : mode = optarg; break;
+            case 's' : save = optarg; break;
+            case 'b' : baseline = optarg; break;
+            case 't' : threshold = atof(optarg); break;
+            default  : optind = argc + 1;
+        }
+    }
+    if (optind != argc - 1) {
+        fprintf(
+            stderr, "Usage: %s [-L text|async|binary] [-s results] [-b baseline] "
+            "[-t threshold] corpus\n", argv[0]
+        );
+        return 1;
+    }
+
+    int fd = open(argv[optind], O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        perror("[Error] : Cannot open the corpus");
+        return 1;
+    }
+
+    const char *log_path = "pipeline-bench.log";
+    if (strcmp(mode, "binary") == 0) log_set_format(LOG_BINARY);
+    if (strcmp(mode, "text") == 0)
+        log_init(log_path);
+    else
+        log_init_async(log_path, LOG_BLOCK);
+
+    Output output;
+    Line line;
+    int null_fd = open("/dev/null", O_WRONLY);
+    output_init(&output, null_fd, OUTPUT_FLUSH_SIZE);
+    line_init(&line, &output, DEFAULT_LINE_WIDTH);
+    word_open(fd);
+
+    long words = 0, bytes = info.st_size;
+    double start = seconds(), total = seconds();
+
+    while (true) {
+        int count = 0;
+        const char *word;
+        while (count < BATCH_WORDS && (lengths[count] = next_word(&word)) > 0) {
+            int kept = lengths[count] > MAX_WORD_LENGTH + 1 ? MAX_WORD_LENGTH + 1 : lengths[count];
+            memcpy(copies[count], word, kept);
+            spans[count] = copies[count];
+            count++;
+        }
+        double read_done = seconds();
+        stages[0].seconds += read_done - start;
+        if (count == 0) break;
+
+        fill_lines(&line, count);
+        double line_done = seconds();
+        stages[1].seconds += line_done - read_done;
+
+        log_words(count);
+        start = seconds();
+        stages[2].seconds += start - line_done;
+
+        words += count;
+    }
+    line_flush(&line);
+    log_close();    // ← Includes waiting for the background thread to drain.
+    stages[2].seconds += seconds() - start;
+    total = seconds() - total;
+
+    printf("corpus %s: %ld bytes, %ld words, log mode %s\n", argv[optind], bytes, words, mode);
+    for (int i = 0; i < NUM_OF_STAGES; ++i) {
+        printf(
+            "%-6s %8.3f s %14.0f words/s %10.1f MB/s\n", stages[i].name,
+            stages[i].seconds, words / stages[i].seconds, bytes / stages[i].seconds / 1e6
+        );
+    }
+    printf("%-6s %8.3f s %14.0f words/s %10.1f MB/s\n", "total",
+        total, words / total, bytes / total / 1e6);
+
+    if (save != NULL) {
+        FILE *file = fopen(save, "w");
+        for (int i = 0; file != NULL && i < NUM_OF_STAGES; ++i)
+            fprintf(file, "%s %.0f\n", stages[i].name, words / stages[i].seconds);
+        if (file != NULL) fclose(file);
+    }
+
+    bool passed = baseline == NULL || check_baseline(baseline, threshold, words);
+
+    word_close();
+    line_free(&line);
+    output_close(&output);
+    close(null_fd);
+    unlink(log_path);
+    return passed ? 0 : 2;
+}
@@ -0,0 +1,58 @@
+# Generates the benchmark corpora (once) and runs the benchmarks on them.
+#
+#   ./bench/run-bench.sh                         # 1M, 10M and 100M corpora
+#   SIZES="1M 10M 100M 1G 10G" ./bench/run-bench.sh
+#   LOG_MODE=binary ./bench/run-bench.sh
+#
+# The words per second of every run are saved to bench/results/. When
+# bench/baseline/ has a file with the same name, the run is compared to it and
+# the script fails if a stage is more than THRESHOLD slower. To make the
+# current results the new baseline, copy bench/results/ to bench/baseline/.
+
+cd "$(dirname "$0")/.." || exit 1
+
+SIZES=${SIZES:-"1M 10M 100M"}
+DISTRIBUTIONS=${DISTRIBUTIONS:-"english short long"}
+LOG_MODE=${LOG_MODE:-text}
+THRESHOLD=${THRESHOLD:-0.1}
+CORPORA=${CORPORA:-bench/corpora}
+
+echo ">> Build the program and the benchmarks"
+
+make justify bench > /dev/null || exit 1
+mkdir -p "$CORPORA" bench/results
+
+status=0
+
+for size in $SIZES; do
+  for distribution in $DISTRIBUTIONS; do
+    corpus="$CORPORA/$distribution-$size.txt"
+    name="$distribution-$size-$LOG_MODE"
+
+    if [ ! -f "$corpus" ]; then
+      echo ">> Generate $corpus"
+      ./bench/make-corpus "$size" "$distribution" > "$corpus"
+    fi
+
+    echo ">> "
+    echo ">> Stages on $corpus"
+
+    baseline=""
+    if [ -f "bench/baseline/$name" ]; then
+      baseline="-b bench/baseline/$name -t $THRESHOLD"
+    fi
+    ./bench/pipeline-bench -L "$LOG_MODE" -s "bench/results/$name" $baseline "$corpus" \
+      || status=1
+
+    echo ">> Whole program on $corpus"
+
+    start=$(date +%s.%N)
+    ./justify < "$corpus" > /dev/null
+    end=$(date +%s.%N)
+    bytes=$(wc -c < "$corpus")
+    echo "$start $end $bytes" | awk '{ printf "justify %8.3f s %10.1f MB/s\n", $2 - $1, $3 / ($2 - $1) / 1e6 }'
+    rm -f a.log
+  done
+done
+
+exit $status
@@ -0,0 +1,47 @@
+# Builds `justify` with AddressSanitizer and runs it on inputs that once
+# read or wrote out of bounds. ASan stops the program at the first bad access,
+# so every run must exit 0 and keep every word of its input.
+#
+#   ./bench/sanitize.sh    (or `make sanitize`)
+#
+# The program is left built with the sanitizer; `make clean` removes it.
+
+cd "$(dirname "$0")/.." || exit 1
+
+echo ">> Build with -fsanitize=address"
+
+make clean > /dev/null
+make justify CFLAGS="-O1 -g -fsanitize=address -fno-omit-frame-pointer" > /dev/null || exit 1
+
+status=0
+
+# Prints `count` words `word` separated by spaces, as one paragraph.
+words() {
+  python3 -c "print(' '.join(['$1'] * $2))"
+}
+
+check() {
+  expected=$1
+  shift
+  echo ">> justify $*"
+  if ! ./justify "$@" < "$input" > "$output"; then
+    echo ">> failed"
+    status=1
+  elif [ "$(wc -w < "$output")" != "$expected" ]; then
+    echo ">> failed: $(wc -w < "$output") words of $expected"
+    status=1
+  fi
+}
+
+input=$(mktemp)
+output=$(mktemp)
+
+# A window of -o holds 4096 words: at these widths a line can be longer than
+# the window, which must still shrink.
+words a 20000 > "$input"
+for width in 60 7000 10000 50000; do
+  check 20000 -o -w "$width"
+done
+
+rm -f "$input" "$output" a.log
+exit $status
@@ -0,0 +1,41 @@
+# Runs the instrumented build of `make pgo` on the training corpus, so that
+# the profile counts the work `justify` really does. Every option with a hot
+# path of its own is used, on text with the word lengths of English prose,
+# with very short and very long words, and on the UTF-8 text shipped in
+# bench/training/.
+#
+#   ./bench/train.sh    (called by `make pgo`, which builds everything first)
+#
+# The generated part of the corpus is deterministic, so two `make pgo` give
+# the same profile.
+
+cd "$(dirname "$0")/.." || exit 1
+
+CORPORA=${CORPORA:-bench/corpora}
+mkdir -p "$CORPORA"
+
+for spec in "4M english 1" "1M short 2" "1M long 3"; do
+  set -- $spec
+  corpus="$CORPORA/training-$2-$1.txt"
+  if [ ! -f "$corpus" ]; then
+    echo ">> Generate $corpus"
+    ./bench/make-corpus "$1" "$2" "$3" > "$corpus" || exit 1
+  fi
+done
+
+run() {
+  echo ">> justify $* < $corpus"
+  ./justify "$@" < "$corpus" > /dev/null || exit 1
+}
+
+for corpus in "$CORPORA"/training-*.txt bench/training/*.txt; do
+  run -l warning
+  run -s 64
+  run -o -l warning
+  run -u -l warning
+  run -h hyphen-en.hyb -l warning
+  run -j 2 -l warning
+  run -a drop -B
+done
+
+rm -f a.log a.binlog
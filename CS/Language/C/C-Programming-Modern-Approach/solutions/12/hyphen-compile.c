@@ -0,0 +1,255 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "hyphen.h"
+
+// Compiles a list of hyphenation patterns (one or more per line, separated by
+// spaces, `%` starting a comment, as in the pattern files of TeX) into the
+// file `hyphen_open` maps into memory:
+//
+//   hyphen-compile [-l left] [-r right] < hyphen-en.pat > hyphen-en.hyb
+//
+//   -l   The fewest letters kept before a break, 2 by default.
+//   -r   The fewest letters kept after a break, 3 by default.
+//
+// The patterns are first put in an ordinary trie whose nodes list their
+// children. The double array is then filled from the root down: the children
+// of a node are placed at `base + c` for the first `base` where all of their
+// slots are still free.
+
+#define MAX_PATTERN_LENGTH 64
+
+typedef struct {
+    int first_child;
+    int next_sibling;
+    uint8_t byte;
+    uint32_t value;         // ← Where the digits of the pattern start, or 0.
+    int state;              // ← The index in the double array.
+} Node;
+
+static Node *nodes = NULL;
+static int num_of_nodes = 0, nodes_capacity = 0;
+
+static uint8_t *digits = NULL;
+static int digits_length = 0, digits_capacity = 0;
+
+static int32_t *base = NULL, *check = NULL;
+static uint32_t *values = NULL;
+static int num_of_states = 0, states_capacity = 0;
+
+static void* grow(void *memory, int *capacity, int needed, size_t size) {
+    int larger = *capacity > 0 ? *capacity : 256;
+    while (larger < needed) larger *= 2;
+
+    memory = realloc(memory, larger * size);
+    if (memory == NULL) {
+        fprintf(stderr, "[Error] : realloc failed in <function:grow>\n");
+        exit(EXIT_FAILURE);
+    }
+    *capacity = larger;
+    return memory;
+}
+
+static int new_node(uint8_t byte) {
+    if (num_of_nodes == nodes_capacity)
+        nodes = grow(nodes, &nodes_capacity, num_of_nodes + 1, sizeof(Node));
+
+    Node *node = &nodes[num_of_nodes];
+    node->first_child = -1;
+    node->next_sibling = -1;
+    node->byte = byte;
+    node->value = 0;
+    node->state = -1;
+    return num_of_nodes++;
+}
+
+// The children are kept sorted by byte, which makes the output the same
+// whatever the order of the patterns.
+
+static int child(int parent, uint8_t byte) {
+    int previous = -1, next = nodes[parent].first_child;
+
+    while (next >= 0 && nodes[next].byte < byte) {
+        previous = next;
+        next = nodes[next].next_sibling;
+    }
+    if (next >= 0 && nodes[next].byte == byte) return next;
+
+    int node = new_node(byte);      // ← May move the nodes, so no pointers.
+    nodes[node].next_sibling = next;
+    if (previous < 0) {
+        nodes[parent].first_child = node;
+    } else {
+        nodes[previous].next_sibling = node;
+    }
+    return node;
+}
+
+static void add_pattern(const char *pattern) {
+    uint8_t letters[MAX_PATTERN_LENGTH], points[MAX_PATTERN_LENGTH + 1];
+    int num_of_letters = 0;
+
+    memset(points, 0, sizeof(points));
+    for (const char *p = pattern; *p != '\0'; ++p) {
+        if (*p >= '0' && *p <= '9') {
+            points[num_of_letters] = *p - '0';
+        } else if (num_of_letters < MAX_PATTERN_LENGTH) {
+            letters[num_of_letters++] = *p;
+        } else {
+            fprintf(stderr, "[Error] : pattern \"%s\" is too long\n", pattern);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (num_of_letters == 0) return;
+
+    int node = 0;
+    for (int i = 0; i < num_of_letters; ++i) node = child(node, letters[i]);
+
+    if (digits_length + num_of_letters + 2 > digits_capacity)
+        digits = grow(digits, &digits_capacity, digits_length + num_of_letters + 2, 1);
+    nodes[node].value = digits_length;
+    digits[digits_length++] = num_of_letters + 1;
+    memcpy(digits + digits_length, points, num_of_letters + 1);
+    digits_length += num_of_letters + 1;
+}
+
+static void ensure_states(int needed) {
+    int old_capacity = states_capacity;
+    if (needed <= states_capacity) return;
+
+    int capacity = states_capacity;
+    base = grow(base, &capacity, needed, sizeof(int32_t));
+    capacity = states_capacity;
+    check = grow(check, &capacity, needed, sizeof(int32_t));
+    capacity = states_capacity;
+    values = grow(values, &capacity, needed, sizeof(uint32_t));
+    states_capacity = capacity;
+
+    for (int i = old_capacity; i < states_capacity; ++i) {
+        base[i] = 0;
+        check[i] = -1;
+        values[i] = 0;
+    }
+}
+
+static bool fits(int candidate, int node) {
+    for (int c = nodes[node].first_child; c >= 0; c = nodes[c].next_sibling) {
+        int slot = candidate + nodes[c].byte;
+        ensure_states(slot + 1);
+        if (check[slot] != -1 || slot == 0) return false;
+    }
+    return true;
+}
+
+// Places the nodes in breadth-first order, so the queue is just the array of
+// nodes sorted by the time they were placed.
+
+static void build_double_array(void) {
+    int *queue = malloc(num_of_nodes * sizeof(int));
+    int head = 0, tail = 0, first_free = 1;
+
+    if (queue == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:build_double_array>\n");
+        exit(EXIT_FAILURE);
+    }
+
+    ensure_states(256);
+    nodes[0].state = 0;
+    check[0] = 0;       // ← The root is used, and is nobody's child.
+    num_of_states = 1;
+    queue[tail++] = 0;
+
+    while (head < tail) {
+        int node = queue[head++];
+        int state = nodes[node].state;
+
+        values[state] = nodes[node].value;
+        if (nodes[node].first_child < 0) continue;
+
+        while (check[first_free] != -1) {
+            first_free++;
+            ensure_states(first_free + 1);
+        }
+        int candidate = first_free - nodes[nodes[node].first_child].byte;
+        if (candidate < 0) candidate = 0;
+        while (!fits(candidate, node)) candidate++;
+
+        base[state] = candidate;
+        for (int c = nodes[node].first_child; c >= 0; c = nodes[c].next_sibling) {
+            int slot = candidate + nodes[c].byte;
+            check[slot] = state;
+            nodes[c].state = slot;
+            if (slot + 1 > num_of_states) num_of_states = slot + 1;
+            queue[tail++] = c;
+        }
+    }
+    check[0] = -1;
+    free(queue);
+}
+
+static void write_all(const void *data, size_t size) {
+    if (fwrite(data, 1, size, stdout) != size) {
+        perror("[Error] : write failed in <function:write_all>");
+        exit(EXIT_FAILURE);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    HyphenHeader header = { .left_min = 2, .right_min = 3 };
+    char pattern[MAX_PATTERN_LENGTH * 2 + 1];
+    int option, ch, length = 0, num_of_patterns = 0;
+    bool in_comment = false;
+
+    while ((option = getopt(argc, argv, "l:r:")) != -1) {
+        switch (option) {
+            case 'l' : header.left_min = atoi(optarg); break;
+            case 'r' : header.right_min = atoi(optarg); break;
+            default  :
+                fprintf(stderr, "Usage: %s [-l left] [-r right] < patterns > compiled\n", argv[0]);
+                return 1;
+        }
+    }
+
+    new_node(0);
+    digits = grow(digits, &digits_capacity, 1, 1);
+    digits[digits_length++] = 0;    // ← So that no pattern starts at 0.
+
+    do {
+        ch = getchar();
+        if (ch == '%') in_comment = true;
+        if (ch == '\n') in_comment = false;
+
+        if (ch == EOF || ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || in_comment) {
+            if (length > 0) {
+                pattern[length] = '\0';
+                add_pattern(pattern);
+                num_of_patterns++;
+                length = 0;
+            }
+        } else if (length < (int)sizeof(pattern) - 1) {
+            pattern[length++] = ch;
+        }
+    } while (ch != EOF);
+
+    build_double_array();
+
+    memcpy(header.magic, HYPHEN_MAGIC, 4);
+    header.version = HYPHEN_VERSION;
+    header.num_of_states = num_of_states;
+    header.digits_length = digits_length;
+
+    write_all(&header, sizeof(header));
+    write_all(base, num_of_states * sizeof(int32_t));
+    write_all(check, num_of_states * sizeof(int32_t));
+    write_all(values, num_of_states * sizeof(uint32_t));
+    write_all(digits, digits_length);
+
+    fprintf(
+        stderr, "%d patterns, %d trie nodes, %d states\n",
+        num_of_patterns, num_of_nodes, num_of_states
+    );
+    return 0;
+}
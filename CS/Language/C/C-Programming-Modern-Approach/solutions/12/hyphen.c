@@ -0,0 +1,151 @@
+#include "hyphen.h"
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The compiled patterns are mapped read-only, so loading them costs nothing
+// more than checking that the file is what it claims to be, and any number of
+// programs share the same pages of memory.
+
+struct Hyphenator {
+    void *map;
+    size_t map_length;
+
+    const HyphenHeader *header;
+    const int32_t *base;
+    const int32_t *check;
+    const uint32_t *values;
+    const uint8_t *digits;
+};
+
+// Checks every index the lookup follows, so a damaged file is rejected here
+// instead of making the lookup read outside the mapping.
+
+static bool is_consistent(const Hyphenator *hyphenator) {
+    const HyphenHeader *header = hyphenator->header;
+    uint32_t num_of_states = header->num_of_states;
+
+    if (num_of_states == 0) return false;
+    for (uint32_t s = 0; s < num_of_states; ++s) {
+        if (hyphenator->base[s] < 0 || hyphenator->check[s] < -1) return false;
+        if (hyphenator->check[s] >= (int32_t)num_of_states) return false;
+
+        uint32_t value = hyphenator->values[s];
+        if (value == 0) continue;
+        if (value >= header->digits_length) return false;
+        if (value + 1 + hyphenator->digits[value] > header->digits_length) return false;
+    }
+    return true;
+}
+
+Hyphenator* hyphen_open(const char *filename) {
+    struct stat info;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(HyphenHeader)) {
+        close(fd);
+        return NULL;
+    }
+    void *map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    Hyphenator *hyphenator = (Hyphenator*)malloc(sizeof(Hyphenator));
+    if (hyphenator == NULL) {
+        munmap(map, info.st_size);
+        return NULL;
+    }
+    hyphenator->map = map;
+    hyphenator->map_length = info.st_size;
+
+    const HyphenHeader *header = map;
+    size_t num_of_states = header->num_of_states;
+    size_t expected = sizeof(HyphenHeader) + num_of_states * 12 + header->digits_length;
+
+    if (
+        memcmp(header->magic, HYPHEN_MAGIC, 4) != 0 ||
+        header->version != HYPHEN_VERSION ||
+        expected != hyphenator->map_length
+    ) {
+        hyphen_close(hyphenator);
+        return NULL;
+    }
+
+    hyphenator->header = header;
+    hyphenator->base = (const int32_t*)(header + 1);
+    hyphenator->check = hyphenator->base + num_of_states;
+    hyphenator->values = (const uint32_t*)(hyphenator->check + num_of_states);
+    hyphenator->digits = (const uint8_t*)(hyphenator->values + num_of_states);
+
+    if (!is_consistent(hyphenator)) {
+        hyphen_close(hyphenator);
+        return NULL;
+    }
+    return hyphenator;
+}
+
+void hyphen_close(Hyphenator *hyphenator) {
+    if (hyphenator == NULL) return;
+    munmap(hyphenator->map, hyphenator->map_length);
+    free(hyphenator);
+}
+
+// The word is looked up as ".word." so that patterns can match at its ends.
+// Starting at each position, the trie is followed as long as the letters
+// match, and the digits of every pattern met on the way are merged into
+// `points` by keeping the largest.
+
+int hyphen_breaks(const Hyphenator *hyphenator, const char *word, int length, bool *breaks) {
+    uint8_t dotted[HYPHEN_MAX_WORD + 2];
+    uint8_t points[HYPHEN_MAX_WORD + 3];
+    const HyphenHeader *header = hyphenator->header;
+    int32_t num_of_states = header->num_of_states;
+    int dotted_length = length + 2;
+    int count = 0;
+
+    memset(breaks, 0, length * sizeof(bool));
+    if (length > HYPHEN_MAX_WORD || length < header->left_min + header->right_min)
+        return 0;
+
+    dotted[0] = '.';
+    for (int i = 0; i < length; ++i) dotted[i + 1] = tolower((unsigned char)word[i]);
+    dotted[length + 1] = '.';
+    memset(points, 0, dotted_length + 1);
+
+    for (int i = 0; i < dotted_length; ++i) {
+        int32_t state = 0;
+
+        for (int j = i; j < dotted_length; ++j) {
+            int32_t next = hyphenator->base[state] + dotted[j];
+            if (next >= num_of_states || hyphenator->check[next] != state) break;
+            state = next;
+
+            uint32_t value = hyphenator->values[state];
+            if (value == 0) continue;
+
+            // A pattern of j - i + 1 letters has one more digit than that.
+            const uint8_t *digits = hyphenator->digits + value;
+            int num_of_digits = digits[0] < j - i + 2 ? digits[0] : j - i + 2;
+            for (int k = 0; k < num_of_digits; ++k) {
+                if (digits[k + 1] > points[i + k]) points[i + k] = digits[k + 1];
+            }
+        }
+    }
+
+    // points[i + 1] is between word[i - 1] and word[i]. Whatever the patterns
+    // say, a break is never before the first letter or after the last one.
+    int first = header->left_min > 0 ? header->left_min : 1;
+    int last = length - (header->right_min > 0 ? header->right_min : 1);
+    for (int i = first; i <= last; ++i) {
+        if (points[i + 1] % 2 == 1) {
+            breaks[i] = true;
+            count++;
+        }
+    }
+    return count;
+}
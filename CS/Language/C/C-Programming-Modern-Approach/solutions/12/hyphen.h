@@ -0,0 +1,67 @@
+#ifndef HYPHEN_H
+#define HYPHEN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Hyphenation with the patterns of Liang's TeX hyphenation algorithm. A pattern
+// such as "hy3ph" says that between the letters around each digit, a break is
+// allowed if the largest digit there (over all matching patterns) is odd and
+// forbidden if it's even. The pattern "1tio" allows a break before "tio" and
+// ".ach4" forbids one after "ach" at the beginning of a word.
+//
+// The patterns are compiled by `hyphen-compile` into a file that's used as it
+// is after being mapped into memory, written in the byte order of the machine:
+//
+//   [+] A HyphenHeader;
+//   [+] int32 base[num_of_states] and int32 check[num_of_states], the trie
+//       of the letters of the patterns as a double array: state t is the
+//       child of state s by the byte c if t = base[s] + c and check[t] = s
+//       (check is -1 for unused states, state 0 is the root);
+//   [+] uint32 values[num_of_states], where the digits of the pattern ending
+//       at each state start in `digits`, or 0 if no pattern ends there;
+//   [+] uint8 digits[digits_length]: for each pattern, the number of its
+//       digits (one more than its letters) followed by the digits.
+
+#define HYPHEN_MAGIC "JHYP"
+#define HYPHEN_VERSION 1
+
+// A word longer than this is never hyphenated.
+#define HYPHEN_MAX_WORD 64
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t num_of_states;
+    uint32_t digits_length;
+    uint8_t left_min;       // ← Letters kept before the first break.
+    uint8_t right_min;      // ← Letters kept after the last break.
+    uint8_t reserved[2];
+} HyphenHeader;
+
+typedef struct Hyphenator Hyphenator;
+
+/*!
+ * @param [in] [filename] A file written by `hyphen-compile`.
+ * @remark Maps the compiled patterns into memory. Returns NULL if the file
+ * can't be read or is not a compiled pattern file.
+ */
+Hyphenator* hyphen_open(const char *filename);
+
+/*!
+ * @remark Unmaps the patterns.
+ */
+void hyphen_close(Hyphenator *hyphenator);
+
+/*!
+ * @param [in] [word] The word, `length` ASCII letters.
+ * @param [out] [breaks] `breaks[i]` is true if the word may be broken before
+ * `word[i]`, for i from 0 to length - 1.
+ * @remark Returns the number of places the word may be broken at, never
+ * closer to its ends than the `left_min` and `right_min` of the patterns. The
+ * patterns are looked up for every position of the word, which only takes a
+ * few transitions of the trie each.
+ */
+int hyphen_breaks(const Hyphenator *hyphenator, const char *word, int length, bool *breaks);
+
+#endif
@@ -1,5 +1,8 @@
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 // C compilers usually provide some method of specifying the value of a macro
 // at the time a program is compiled. This ability makes it easy to change the
@@ -10,40 +13,181 @@
 //
 // gcc -DDEBUG=1 foo.c   (that's to write `#define DEBUG 1`)
 
+#include "libjustify.h"
 #include "line.h"
 #include "word.h"
 #include "log.h"
+#include "parallel.h"
+#include "batch.h"
+#include "output.h"
+#include "utf8.h"
 
-#define MAX_WORD_LENGTH 20
+// The justification itself is done by the library in `libjustify.c`; this
+// program only reads the input in large blocks, feeds them to the library and
+// writes what comes out.
 
-int main(void) {
-    log_init("a.log");
-    char word[MAX_WORD_LENGTH + 2];
-    int word_length;
+#define BLOCK_SIZE (1 << 20)
 
-    clear_line();
+// Usage: justify [-o] [-j threads] [-f bytes] [-a drop|block] [-B] [-l level] [-s n] [-w width] [-u] [-h patterns] < input
+//        justify -b list|directory [-O directory] [other options]
+//
+//   -o   Chooses the line breaks of the whole paragraph together so that the
+//        spacing is as even as possible (see `paragraph.c`), instead of
+//        filling each line greedily.
+//   -j   Justifies the input with this many threads (see `parallel.c`). The
+//        output is the same as with one thread, but the "Read word" messages
+//        aren't logged, so -s does nothing. Not used together with -o.
+//   -f   Writes the output whenever this many bytes of lines are collected
+//        (see `output.c`), 0 writes every line at once. The default is 1 MiB.
+//   -a   Writes the log from a background thread (see `log.c`). When it falls
+//        behind, messages are either dropped or the program waits for it.
+//   -B   Writes the log in binary to `a.binlog` instead of `a.log`, which is
+//        read with `log-decode < a.binlog`.
+//   -l   Only logs messages of this level or above: info, warning or error.
+//   -s   Only logs one in this many "Read word" messages.
+//   -w   Justifies lines to this many characters instead of 60.
+//   -u   Reads the input as UTF-8 and counts the columns each character takes
+//        on the screen (see `utf8.c`), so that lines of Chinese or accented
+//        text line up too. Not used together with -j.
+//   -h   Hyphenates words that don't fit at the end of a line, with patterns
+//        compiled by `hyphen-compile` (see `hyphen.h`), for example
+//        `make hyphen-en.hyb`. Not used together with -j.
+//   -b   Justifies many files in one run (see `batch.c`): the files listed one
+//        per line in the given file ("-" for the standard input), or the files
+//        of the given directory but its ".out" ones. Each one is written to a
+//        file of its own and a line per file reports how it went. -j sets how
+//        many files are justified at the same time, all processors by default.
+//   -O   Writes the files justified by -b to this directory, instead of next
+//        to them with ".out" appended. Two files of the same name are refused.
 
-    while (true) {
-        read_word(word, MAX_WORD_LENGTH + 1);
-        word_length = strlen(word);
-        log_message(LOG_INFO, "Read word \"%s\"", word);
+static void log_word(const char *word, int length, void *user_data) {
+    unsigned long sample_rate = *(unsigned long*)user_data;
+    LOG_SAMPLED(LOG_INFO, sample_rate, "Read word \"%.*s\"", length, word);
+}
 
-        if (word_length == 0) {
-            flush_line();
-            log_close();
-            return 0;
-        }
-        if (word_length > MAX_WORD_LENGTH) word[MAX_WORD_LENGTH] = '*';
-        // Notice word[MAX_WORD_LENGTH] = '*' and word[MAX_WORD_LENGTH + 1] = '\0'
+static void write_output(const char *data, size_t length, void *user_data) {
+    output_write((Output*)user_data, data, length);
+}
 
-        if (word_length + 1 > space_remaining()) {
-            write_line();
-            clear_line();
+int main(int argc, char *argv[]) {
+    bool optimal = false;
+    bool utf8 = false;
+    bool reported_invalid = false;
+    Hyphenator *hyphenator = NULL;
+    bool async_log = false;
+    const char *log_filename = "a.log";
+    LogOverflowPolicy overflow_policy = LOG_DROP;
+    int num_of_threads = 0;
+    const char *batch_input = NULL;
+    const char *batch_output = NULL;
+    unsigned long sample_rate = 1;
+    int option;
+
+    while ((option = getopt(argc, argv, "oj:f:a:Bl:s:w:uh:b:O:")) != -1) {
+        switch (option) {
+            case 'o' : optimal = true; break;
+            case 'j' : num_of_threads = atoi(optarg); break;
+            case 'f' : standard_output()->flush_size = atol(optarg); break;
+            case 'a' :
+                async_log = true;
+                overflow_policy = strcmp(optarg, "block") == 0 ? LOG_BLOCK : LOG_DROP;
+                break;
+            case 'B' :
+                log_set_format(LOG_BINARY);
+                log_filename = "a.binlog";
+                break;
+            case 'l' :
+                if (strcmp(optarg, "warning") == 0) log_set_level(LOG_WARNING);
+                else if (strcmp(optarg, "error") == 0) log_set_level(LOG_ERROR);
+                else log_set_level(LOG_INFO);
+                break;
+            case 's' :
+                sample_rate = strtoul(optarg, NULL, 10);
+                if (sample_rate == 0) sample_rate = 1;
+                break;
+            case 'w' :
+                set_line_width(atoi(optarg) > 0 ? atoi(optarg) : DEFAULT_LINE_WIDTH);
+                break;
+            case 'u' : utf8 = true; break;
+            case 'h' :
+                hyphenator = hyphen_open(optarg);
+                if (hyphenator == NULL) {
+                    fprintf(stderr, "[Error] : %s is not a compiled pattern file\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'b' : batch_input = optarg; break;
+            case 'O' : batch_output = optarg; break;
+            default  :
+                fprintf(
+                    stderr, "Usage: %s [-o] [-j threads] [-f bytes] [-a drop|block] [-B] [-l level] [-s n] [-w width] [-u] [-h patterns] < input\n"
+                    "       %s -b list|directory [-O directory] [other options]\n",
+                    argv[0], argv[0]
+                );
+                return 1;
         }
+    }
+
+    if (async_log)
+        log_init_async(log_filename, overflow_policy);
+    else
+        log_init(log_filename);
+
+    JustifyOptions options = {
+        .width = get_line_width(),
+        .optimal = optimal,
+        .utf8 = utf8,
+        .hyphenator = hyphenator,
+        .on_word = log_word,
+        .user_data = &sample_rate
+    };
 
-        add_word(word);
+    if (batch_input != NULL) {
+        if (num_of_threads <= 0) num_of_threads = sysconf(_SC_NPROCESSORS_ONLN);
+        if (num_of_threads <= 0) num_of_threads = 1;
+
+        int num_of_failures = justify_batch(batch_input, batch_output, &options, num_of_threads);
+        hyphen_close(hyphenator);
+        log_close();
+        return num_of_failures > 0 ? 1 : 0;
+    }
+
+    word_open(STDIN_FILENO);
+    if (num_of_threads > 1 && (optimal || utf8 || hyphenator != NULL)) {
+        LOG(LOG_WARNING, "-j is not supported with -o, -u or -h, using one thread");
+    } else if (num_of_threads > 1) {
+        justify_parallel(num_of_threads);
+        bool failed = word_failed();
+        word_close();
+        log_close();
+        return failed ? 1 : 0;
+    }
+    JustifyContext *context = justify_create(&options);
+    const char *block;
+    size_t size;
+
+    if (context == NULL) {
+        fprintf(stderr, "[Error] : Not enough memory to justify\n");
+        return 1;
+    }
+
+    while ((size = next_block(&block, BLOCK_SIZE)) > 0) {
+        // A block ends at a delimiter, so it never cuts a character in two.
+        if (utf8 && !reported_invalid && !utf8_validate(block, size)) {
+            LOG(LOG_WARNING, "The input is not valid UTF-8, invalid bytes take one column");
+            reported_invalid = true;
+        }
+        justify_feed(context, block, size);
+        justify_drain(context, write_output, standard_output());
     }
+    justify_finish(context);
+    justify_drain(context, write_output, standard_output());
+    output_flush(standard_output());
 
+    justify_destroy(context);
+    hyphen_close(hyphenator);
+    bool failed = word_failed();
+    word_close();
     log_close();
-    return 0;
+    return failed ? 1 : 0;
 }
@@ -0,0 +1,223 @@
+#include "libjustify.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include "line.h"
+#include "output.h"
+#include "paragraph.h"
+#include "utf8.h"
+#include "word.h"
+
+// A word of MAX_WORD_LENGTH columns takes up to 4 bytes per column in UTF-8,
+// and combining marks don't take columns at all, so UTF-8 words are cut at
+// this many bytes whatever their width.
+
+#define MAX_WORD_BYTES (4 * (MAX_WORD_LENGTH + 1))
+
+struct JustifyContext {
+    JustifyOptions options;
+
+    Output output;
+    Line line;
+    Paragraph paragraph;
+
+    // A word cut at the end of the data given to `justify_feed`. Only the
+    // characters that survive the truncation are kept.
+    bool has_pending;
+    char pending[MAX_WORD_BYTES + 2];
+    int pending_length;
+    int pending_limit;
+
+    bool is_ascii;      // ← The data being fed has no UTF-8 to measure.
+};
+
+JustifyContext* justify_create(const JustifyOptions *options) {
+    JustifyContext *context = (JustifyContext*)malloc(sizeof(JustifyContext));
+    if (context == NULL) return NULL;
+
+    if (options != NULL) {
+        context->options = *options;
+    } else {
+        memset(&context->options, 0, sizeof(context->options));
+    }
+    if (context->options.width <= 0) context->options.width = DEFAULT_LINE_WIDTH;
+
+    output_init(&context->output, -1, 0);
+    line_init(&context->line, &context->output, context->options.width);
+    if (context->options.optimal) paragraph_init(&context->paragraph, &context->line);
+    context->has_pending = false;
+    context->pending_length = 0;
+    context->pending_limit = context->options.utf8 ? MAX_WORD_BYTES + 1 : MAX_WORD_LENGTH + 1;
+    context->is_ascii = !context->options.utf8;
+    return context;
+}
+
+void justify_destroy(JustifyContext *context) {
+    if (context == NULL) return;
+
+    if (context->options.optimal) paragraph_free(&context->paragraph);
+    line_free(&context->line);
+    output_close(&context->output);
+    free(context);
+}
+
+// Copies a UTF-8 word to `word` and truncates it like an ASCII word, but by
+// columns: if it's wider than MAX_WORD_LENGTH, the characters that fit in
+// MAX_WORD_LENGTH columns are kept and followed by '*'. Returns the length in
+// bytes and sets the width.
+
+static int measure_word(JustifyContext *context, char *word, const char *span, int length, int *width) {
+    if (length > MAX_WORD_BYTES + 1) length = MAX_WORD_BYTES + 1;
+
+    int logged_width;
+    int logged = utf8_prefix(span, length, MAX_WORD_LENGTH + 1, &logged_width);
+    if (context->options.on_word != NULL)
+        context->options.on_word(span, logged, context->options.user_data);
+
+    int kept = utf8_prefix(span, logged, MAX_WORD_LENGTH, width);
+    if (kept > MAX_WORD_BYTES) {
+        // Many zero-width marks: keep the characters that end by then, never
+        // the first bytes of one.
+        kept = MAX_WORD_BYTES;
+        while (kept > 0 && ((unsigned char)span[kept] & 0xC0) == 0x80) kept--;
+        kept = utf8_prefix(span, kept, MAX_WORD_LENGTH, width);
+    }
+    memcpy(word, span, kept);
+    if (kept < length) {
+        word[kept++] = '*';
+        (*width)++;
+    }
+    return kept;
+}
+
+// Ends the line with as much of a word that doesn't fit as possible, broken
+// where the hyphenation patterns allow it, and starts the next line with the
+// rest. Punctuation before and after the letters of the word stays with its
+// part. Returns false if the word can't be broken so that its first part fits.
+
+static bool add_hyphenated(JustifyContext *context, const char *word, int length) {
+    Line *line = &context->line;
+    bool breaks[MAX_WORD_LENGTH + 1];
+    char first[MAX_WORD_LENGTH + 2];
+    int begin = 0, end = length;
+
+    while (begin < end && !isalpha((unsigned char)word[begin])) begin++;
+    while (end > begin && !isalpha((unsigned char)word[end - 1])) end--;
+    for (int i = begin; i < end; ++i) {
+        if (!isalpha((unsigned char)word[i])) return false;
+    }
+
+    if (hyphen_breaks(context->options.hyphenator, word + begin, end - begin, breaks) == 0)
+        return false;
+
+    // The first part takes a space before it and a '-' after it.
+    int room = line_space_remaining(line) - 2;
+    int at = end - begin - 1;
+    while (at > 0 && !(breaks[at] && begin + at <= room)) at--;
+    if (at == 0) return false;
+
+    at += begin;
+    memcpy(first, word, at);
+    first[at] = '-';
+    line_add_word(line, first, at + 1);
+    line_write(line);
+    line_clear(line);
+    line_add_word(line, word + at, length - at);
+    return true;
+}
+
+// Handles one complete word, the same way the loop of `justify.c` always did.
+
+static void process_word(JustifyContext *context, const char *span, int length, bool is_ascii) {
+    char word[MAX_WORD_BYTES + 2];
+    Line *line = &context->line;
+    int width;
+
+    if (is_ascii) {
+        if (length > MAX_WORD_LENGTH + 1) length = MAX_WORD_LENGTH + 1;
+        memcpy(word, span, length);
+        if (context->options.on_word != NULL)
+            context->options.on_word(word, length, context->options.user_data);
+        if (length > MAX_WORD_LENGTH) word[MAX_WORD_LENGTH] = '*';
+        // Notice word[MAX_WORD_LENGTH] = '*' is the last of the MAX_WORD_LENGTH + 1
+        // characters kept.
+        width = length;
+    } else {
+        length = measure_word(context, word, span, length, &width);
+    }
+
+    if (context->options.optimal) {
+        paragraph_add_word(&context->paragraph, word, length, width);
+        return;
+    }
+
+    if (line->num_of_words > 0 && width + 1 > line_space_remaining(line)) {
+        if (
+            context->options.hyphenator != NULL && is_ascii &&
+            length <= MAX_WORD_LENGTH && add_hyphenated(context, word, length)
+        ) {
+            return;
+        }
+        line_write(line);
+        line_clear(line);
+    }
+    line_add_word_width(line, word, length, width);
+}
+
+static void keep_pending(JustifyContext *context, const char *span, int length) {
+    int room = context->pending_limit - context->pending_length;
+    if (length > room) length = room;
+
+    memcpy(context->pending + context->pending_length, span, length);
+    context->pending_length += length;
+    context->has_pending = true;
+}
+
+static void add_pending(JustifyContext *context) {
+    bool is_ascii = !context->options.utf8 ||
+        utf8_ascii_length(context->pending, context->pending_length) == (size_t)context->pending_length;
+
+    process_word(context, context->pending, context->pending_length, is_ascii);
+    context->has_pending = false;
+    context->pending_length = 0;
+}
+
+void justify_feed(JustifyContext *context, const char *data, size_t length) {
+    const char *cursor = data, *end = data + length, *word;
+    int word_length;
+
+    // Most pieces of UTF-8 text have no character outside ASCII at all, then
+    // every word is handled as in the byte mode without measuring it.
+    if (context->options.utf8)
+        context->is_ascii = utf8_ascii_length(data, length) == length;
+
+    if (context->has_pending) {
+        cursor = find_word_end(data, end);
+        keep_pending(context, data, cursor - data);
+        if (cursor == end) return;
+        add_pending(context);
+    }
+
+    while ((word_length = scan_word(&cursor, end, &word)) > 0) {
+        if (cursor == end) {
+            keep_pending(context, word, word_length);   // ← It may go on.
+            break;
+        }
+        process_word(context, word, word_length, context->is_ascii);
+    }
+}
+
+void justify_finish(JustifyContext *context) {
+    if (context->has_pending) add_pending(context);
+    if (context->options.optimal) paragraph_flush(&context->paragraph);
+    line_flush(&context->line);
+    line_clear(&context->line);
+}
+
+size_t justify_drain(JustifyContext *context, JustifyWriter writer, void *user_data) {
+    size_t length = context->output.length;
+
+    if (length > 0) writer(context->output.data, length, user_data);
+    context->output.length = 0;
+    return length;
+}
@@ -0,0 +1,87 @@
+#ifndef LIBJUSTIFY_H
+#define LIBJUSTIFY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "hyphen.h"
+
+// The justification of `justify` as a library. Everything about one text is
+// kept in a `JustifyContext`, so any number of texts can be justified at the
+// same time, and the text is given and taken back in pieces of any size:
+//
+//   JustifyContext *context = justify_create(&options);
+//   while (there's more text) {
+//       justify_feed(context, piece, piece_length);
+//       justify_drain(context, write_somewhere, destination);
+//   }
+//   justify_finish(context);
+//   justify_drain(context, write_somewhere, destination);
+//   justify_destroy(context);
+//
+// All the memory of a context is allocated when it's created (or when it grows
+// to hold a longer output than ever before), never for a single word.
+//
+// With `utf8` set, the width of a line and of the words is counted in columns
+// on the screen instead of bytes, and a long word is truncated after its last
+// whole character that fits (see `utf8.h`). Pieces of the input that are all
+// ASCII are justified exactly as without it.
+//
+// With a `hyphenator` (see `hyphen.h`), a word that doesn't fit on a line is
+// broken at its last allowed place that still fits, and its first part ends
+// the line followed by '-'. Only the greedy filling does this; words made
+// of other things than ASCII letters, except for punctuation around them,
+// and truncated words are never broken.
+
+typedef struct JustifyContext JustifyContext;
+
+/*!
+ * @remark Called with every word of the input (before it's truncated), for
+ * example to log it. `user_data` is the one given in the options.
+ */
+typedef void (*JustifyWordHook)(const char *word, int length, void *user_data);
+
+/*!
+ * @remark Called by `justify_drain` with justified text.
+ */
+typedef void (*JustifyWriter)(const char *data, size_t length, void *user_data);
+
+typedef struct {
+    int width;              // ← Characters per line, 0 for the default 60.
+    bool optimal;           // ← Minimize the badness of the paragraph.
+    bool utf8;              // ← Measure words in columns of UTF-8 text.
+    const Hyphenator *hyphenator;   // ← Hyphenate words that don't fit, or NULL.
+    JustifyWordHook on_word;
+    void *user_data;
+} JustifyOptions;
+
+/*!
+ * @param [in] [options] How to justify, NULL for the defaults.
+ * @remark Returns a new context, or NULL if there's not enough memory.
+ */
+JustifyContext* justify_create(const JustifyOptions *options);
+
+/*!
+ * @remark Releases the context and everything it holds.
+ */
+void justify_destroy(JustifyContext *context);
+
+/*!
+ * @param [in] [data] The next `length` bytes of the input.
+ * @remark Justifies as much of the input as possible. A word cut at the end of
+ * `data` is completed by the next call.
+ */
+void justify_feed(JustifyContext *context, const char *data, size_t length);
+
+/*!
+ * @remark Tells the context the input is complete, so that the last word and
+ * the last line (which is not justified) are produced.
+ */
+void justify_finish(JustifyContext *context);
+
+/*!
+ * @param [in] [writer] Called with the text justified so far, if any.
+ * @remark Returns the number of bytes handed to `writer`.
+ */
+size_t justify_drain(JustifyContext *context, JustifyWriter writer, void *user_data);
+
+#endif
@@ -1,5 +1,6 @@
 #include "line.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 // To run the program from a UNIX-like a Windows operating system, when we enter
@@ -16,58 +17,173 @@
 //
 // The `>` symbol is called *output redirection*.
 
-#define MAX_LINE_LENGTH 60
+static Line current_line = { .out = NULL };
+static int current_width = DEFAULT_LINE_WIDTH;
 
-char line[MAX_LINE_LENGTH + 1];
-int line_length = 0;
-int num_of_words = 0;
+static void* grow(void *memory, int *capacity, int needed, size_t size) {
+    int larger = *capacity > 0 ? *capacity : 16;
+    while (larger < needed) larger *= 2;
 
-void clear_line(void) {
-    line[0] = '\0';
-    line_length = 0;
-    num_of_words = 0;
+    memory = realloc(memory, larger * size);
+    if (memory == NULL) {
+        fprintf(stderr, "[Error] : realloc failed in <function:grow>\n");
+        exit(EXIT_FAILURE);
+    }
+    *capacity = larger;
+    return memory;
 }
 
-void add_word(const char *word) {
-    if (num_of_words > 0) {
-        line[line_length] = ' ';
-        line[line_length + 1] = '\0';
-    }
-    strcat(line, word);
-    if (num_of_words == 0) {
-        line_length += strlen(word);
+void line_init(Line *line, Output *out, int width) {
+    line->width = width;
+    line->out = out;
+
+    // A full line never has more characters than its width, nor more words
+    // than one in every two of those characters.
+    line->text = NULL;
+    line->text_capacity = 0;
+    line->text = grow(line->text, &line->text_capacity, width + 1, 1);
+    line->words = NULL;
+    line->words_capacity = 0;
+    line->words = grow(line->words, &line->words_capacity, width / 2 + 1, sizeof(WordSpan));
+
+    line_clear(line);
+}
+
+void line_free(Line *line) {
+    free(line->text);
+    free(line->words);
+    line->text = NULL;
+    line->words = NULL;
+    line->text_capacity = 0;
+    line->words_capacity = 0;
+}
+
+void line_clear(Line *line) {
+    line->length = 0;
+    line->text_length = 0;
+    line->num_of_words = 0;
+}
+
+void line_add_word(Line *line, const char *word, int length) {
+    line_add_word_width(line, word, length, length);
+}
+
+void line_add_word_width(Line *line, const char *word, int length, int width) {
+    if (line->text_length + length > line->text_capacity)
+        line->text = grow(line->text, &line->text_capacity, line->text_length + length, 1);
+    if (line->num_of_words == line->words_capacity)
+        line->words = grow(
+            line->words, &line->words_capacity, line->num_of_words + 1, sizeof(WordSpan)
+        );
+
+    memcpy(line->text + line->text_length, word, length);
+    line->words[line->num_of_words].offset = line->text_length;
+    line->words[line->num_of_words].length = length;
+    line->words[line->num_of_words].width = width;
+    line->text_length += length;
+
+    if (line->num_of_words == 0) {
+        line->length += width;
     } else {
-        line_length += (strlen(word) + 1);
+        line->length += width + 1;
     }
-    num_of_words++;
+    line->num_of_words++;
 }
 
-// strcat("", "This") => "This" | line_length = 4
-//   line[4] = ' ', line[5] = '\0'
-// strcat("This ", "is") => "This is" | line_length = 4 + (2 + 1) = 7
+// "This" => words { 0, 4 } | line_length = 4
+// "This" "is" => words { 0, 4 } { 4, 2 } | line_length = 4 + (2 + 1) = 7
+//
+// The length of a line counts columns, so the padding is right for words
+// wider or narrower than their bytes, while the buffer needs the bytes:
+// `text_length` plus one byte for every space.
 
-int space_remaining(void) {
-    return MAX_LINE_LENGTH - line_length;
+int line_space_remaining(const Line *line) {
+    return line->width - line->length;
 }
 
-void write_line(void) {
+// The justified line is built in the output buffer in one pass: each word is
+// copied with `memcpy` and the gap after it is filled with its share of the
+// padding with `memset`.
+
+void line_write(Line *line) {
     int extra_spaces, spaces_to_insert;
-    extra_spaces = MAX_LINE_LENGTH - line_length;
-
-    for (int i = 0; i < line_length; ++i) {
-        if (line[i] != ' ')
-            putchar(line[i]);
-        else {
-            spaces_to_insert = extra_spaces / (num_of_words - 1);
-            for (int j = 1; j <= spaces_to_insert + 1; ++j)
-                putchar(' ');
-            extra_spaces -= spaces_to_insert;
-            num_of_words--;
+    int num_of_gaps = line->num_of_words - 1;
+    extra_spaces = line->width - line->length;
+    if (extra_spaces < 0) extra_spaces = 0;
+
+    char *start = output_reserve(
+        line->out, line->text_length + num_of_gaps + extra_spaces + 1
+    );
+    char *next = start;
+
+    for (int i = 0; i < line->num_of_words; ++i) {
+        const WordSpan *word = &line->words[i];
+
+        memcpy(next, line->text + word->offset, word->length);
+        next += word->length;
+        if (i == line->num_of_words - 1) break;
+
+        spaces_to_insert = extra_spaces / num_of_gaps;
+        memset(next, ' ', spaces_to_insert + 1);
+        next += spaces_to_insert + 1;
+        extra_spaces -= spaces_to_insert;
+        num_of_gaps--;
+    }
+    *next++ = '\n';
+
+    output_commit(line->out, next - start);
+}
+
+void line_flush(Line *line) {
+    if (line->length > 0) {
+        char *start = output_reserve(line->out, line->text_length + line->num_of_words);
+        char *next = start;
+
+        for (int i = 0; i < line->num_of_words; ++i) {
+            if (i > 0) *next++ = ' ';
+            memcpy(next, line->text + line->words[i].offset, line->words[i].length);
+            next += line->words[i].length;
         }
+        *next++ = '\n';
+        output_commit(line->out, next - start);
+    }
+    output_flush(line->out);
+}
+
+static Line* get_current_line(void) {
+    if (current_line.out == NULL)
+        line_init(&current_line, standard_output(), current_width);
+    return &current_line;
+}
+
+void set_line_width(int width) {
+    current_width = width;
+    if (current_line.out != NULL) {
+        line_free(&current_line);
+        line_init(&current_line, current_line.out, width);
     }
-    putchar('\n');
+}
+
+int get_line_width(void) {
+    return current_width;
+}
+
+void clear_line(void) {
+    line_clear(get_current_line());
+}
+
+void add_word(const char *word) {
+    line_add_word(get_current_line(), word, strlen(word));
+}
+
+int space_remaining(void) {
+    return line_space_remaining(get_current_line());
+}
+
+void write_line(void) {
+    line_write(get_current_line());
 }
 
 void flush_line(void) {
-    if (line_length > 0) puts(line);
+    line_flush(get_current_line());
 }
@@ -1,6 +1,102 @@
 #ifndef LINE_H
 #define LINE_H
 
+#include "output.h"
+
+#define DEFAULT_LINE_WIDTH 60
+
+// The state of a line being filled. The words are kept side by side in
+// `text` without the spaces between them, and `words` says where each of them
+// starts and how long it is, so adding a word only appends to both and the
+// gaps between words are known without looking for spaces.
+//
+// The functions taking a `Line` only touch the line passed to them, so several
+// lines can be filled at the same time (for example by different threads).
+// The functions without a `Line` work on a single current line which is
+// written to the standard output.
+
+typedef struct {
+    int offset;
+    int length;
+    int width;      // ← Columns on the screen, the same as length for ASCII.
+} WordSpan;
+
+typedef struct {
+    int width;
+    int length;     // ← In columns, including one space between every two words.
+
+    char *text;
+    int text_length;
+    int text_capacity;
+
+    WordSpan *words;
+    int num_of_words;
+    int words_capacity;
+
+    Output *out;
+} Line;
+
+/*!
+ * @param [out] [line] The line to initialize.
+ * @param [in] [out] The output the line is written to.
+ * @param [in] [width] The number of characters of a justified line.
+ * @remark Allocates an empty line and sets where it's written to.
+ */
+void line_init(Line *line, Output *out, int width);
+
+/*!
+ * @remark Releases the memory of the line.
+ */
+void line_free(Line *line);
+
+/*!
+ * @remark Clears the line, keeping its memory.
+ */
+void line_clear(Line *line);
+
+/*!
+ * @param [in] [word] The word, `length` bytes long. It's copied, so it doesn't
+ * have to be null-terminated.
+ * @remark Adds word to the end of the line. If this is not the first word on
+ * the line, puts one space before word.
+ */
+void line_add_word(Line *line, const char *word, int length);
+
+/*!
+ * @param [in] [word] The word, `length` bytes long.
+ * @param [in] [width] The number of columns the word takes on the screen.
+ * @remark Like `line_add_word`, for words whose width is not their length
+ * (see `utf8.h`).
+ */
+void line_add_word_width(Line *line, const char *word, int length, int width);
+
+/*!
+ * @remark Returns the number of columns left in the line.
+ */
+int line_space_remaining(const Line *line);
+
+/*!
+ * @remark Writes the line with justification to its output. The line isn't
+ * cleared.
+ */
+void line_write(Line *line);
+
+/*!
+ * @remark Writes the line without justification. If the line is empty, writes
+ * nothing. Then writes everything still collected in its output.
+ */
+void line_flush(Line *line);
+
+/*!
+ * @remark Sets the width of the current line, before anything is added to it.
+ */
+void set_line_width(int width);
+
+/*!
+ * @remark Returns the width of the current line.
+ */
+int get_line_width(void);
+
 /*!
  * @remark Clears the current line
  */
@@ -25,7 +121,7 @@ void write_line(void);
 
 /*!
  * @remark Writes the current line without justification. If the line is empty,
- * does nothing.
+ * does nothing. Then writes everything still collected in the output.
  */
 void flush_line(void);
 
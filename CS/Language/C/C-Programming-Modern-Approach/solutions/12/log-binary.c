@@ -0,0 +1,55 @@
+#include "log-binary.h"
+#include <string.h>
+
+const char* scan_conversion(const char *spec, char *types, int *num_of_types, int *precision) {
+    const char *p = spec + 1;
+    int longs = 0, digits = LOG_PRECISION_NONE;
+
+    *num_of_types = 0;
+    if (precision != NULL) *precision = LOG_PRECISION_NONE;
+    if (*p == '%') return p + 1;
+
+    while (*p != '\0' && strchr("-+ #0", *p) != NULL) p++;     // ← Flags
+    if (*p == '*') {
+        types[(*num_of_types)++] = LOG_ARG_INT;
+        p++;
+    }
+    while (*p >= '0' && *p <= '9') p++;                         // ← Width
+    if (*p == '.') {
+        p++;
+        digits = 0;
+        if (*p == '*') {
+            types[(*num_of_types)++] = LOG_ARG_INT;
+            digits = LOG_PRECISION_STAR;
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') digits = 10 * digits + (*p++ - '0');  // ← Precision
+    }
+    if (precision != NULL) *precision = digits;
+    while (*p != '\0' && strchr("hlLqjzt", *p) != NULL) {       // ← Length
+        if (*p != 'h') longs++;
+        p++;
+    }
+
+    switch (*p) {
+        case 'd' : case 'i' : case 'u' : case 'o' : case 'x' : case 'X' :
+            types[(*num_of_types)++] = longs > 0 ? LOG_ARG_LONG : LOG_ARG_INT;
+            break;
+        case 'c' :
+            types[(*num_of_types)++] = LOG_ARG_INT;
+            break;
+        case 'f' : case 'F' : case 'e' : case 'E' :
+        case 'g' : case 'G' : case 'a' : case 'A' :
+            types[(*num_of_types)++] = LOG_ARG_DOUBLE;
+            break;
+        case 's' :
+            types[(*num_of_types)++] = LOG_ARG_STRING;
+            break;
+        case 'p' :
+            types[(*num_of_types)++] = LOG_ARG_POINTER;
+            break;
+        case '\0' :
+            return p;
+    }
+    return p + 1;
+}
@@ -0,0 +1,50 @@
+#ifndef LOG_BINARY_H
+#define LOG_BINARY_H
+
+#include <stdint.h>
+
+// The binary log is a stream of records, written in the byte order of the
+// machine that wrote them:
+//
+//   [+] A session header, each time the log is opened:
+//         "JLOG", uint32 version, int64 wall-clock seconds and nanoseconds,
+//         uint64 clock ticks at the same moment, uint64 ticks per second;
+//   [+] A format record, the first time a format string is used:
+//         'F', uint16 id, uint16 length, the characters of the format;
+//   [+] A message record:
+//         'M', uint8 level, uint16 format id, uint64 clock ticks,
+//         and the arguments in the order of the format.
+//
+// An argument is stored according to its type: LOG_ARG_INT as int32,
+// LOG_ARG_LONG, LOG_ARG_DOUBLE and LOG_ARG_POINTER as 8 bytes, and LOG_ARG_STRING
+// as uint8 length followed by that many characters.
+
+#define LOG_BINARY_MAGIC "JLOG"
+#define LOG_BINARY_VERSION 1
+
+#define LOG_RECORD_FORMAT 'F'
+#define LOG_RECORD_MESSAGE 'M'
+
+#define LOG_ARG_INT 'i'
+#define LOG_ARG_LONG 'l'
+#define LOG_ARG_DOUBLE 'd'
+#define LOG_ARG_POINTER 'p'
+#define LOG_ARG_STRING 's'
+
+#define LOG_MAX_ARGS 16
+
+#define LOG_PRECISION_NONE (-1)
+#define LOG_PRECISION_STAR (-2)     // ← Given by the int argument before the value.
+
+/*!
+ * @param [in] [spec] Points to the '%' starting a conversion specification.
+ * @param [out] [types] The types of the arguments the specification uses (a
+ * `*` width or precision uses an int before the converted argument).
+ * @param [out] [num_of_types] The number of types stored in `types`.
+ * @param [out] [precision] The precision of the specification, or
+ * LOG_PRECISION_NONE, or LOG_PRECISION_STAR. Can be NULL.
+ * @remark Returns a pointer to the character after the specification.
+ */
+const char* scan_conversion(const char *spec, char *types, int *num_of_types, int *precision);
+
+#endif
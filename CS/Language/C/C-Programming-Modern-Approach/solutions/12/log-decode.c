@@ -0,0 +1,189 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "log-binary.h"
+
+// Turns a binary log written with `log_set_format(LOG_BINARY)` back into the
+// text `log_message` writes:
+//
+//   log-decode < a.binlog > a.log
+//
+// Every conversion specification of the format is given to `snprintf` on its
+// own, together with the argument values read from the record.
+
+#define MAX_FORMATS 1024
+#define MAX_FORMAT_LENGTH 256
+
+static char formats[MAX_FORMATS][MAX_FORMAT_LENGTH];
+
+static int64_t base_seconds, base_nanoseconds;
+static uint64_t base_clock, clock_frequency;
+
+static bool read_bytes(void *data, size_t size) {
+    return fread(data, 1, size, stdin) == size;
+}
+
+static const char* level_string(int level) {
+    switch (level) {
+        case 0  : return "info";
+        case 1  : return "warning";
+        case 2  : return "error";
+        default : return "unknown";
+    }
+}
+
+typedef union {
+    int32_t i;
+    int64_t l;
+    double d;
+    uint64_t p;
+    char s[256];
+} Argument;
+
+static bool read_argument(char type, Argument *argument) {
+    uint8_t length;
+
+    switch (type) {
+        case LOG_ARG_INT     : return read_bytes(&argument->i, 4);
+        case LOG_ARG_LONG    : return read_bytes(&argument->l, 8);
+        case LOG_ARG_DOUBLE  : return read_bytes(&argument->d, 8);
+        case LOG_ARG_POINTER : return read_bytes(&argument->p, 8);
+        case LOG_ARG_STRING  :
+            if (!read_bytes(&length, 1) || !read_bytes(argument->s, length))
+                return false;
+            argument->s[length] = '\0';
+            return true;
+    }
+    return false;
+}
+
+// Formats one conversion. `arguments` holds the values for the `*` width and
+// precision (if any) followed by the converted value.
+
+static void print_conversion(
+    const char *spec, const char *types, int count, const Argument *arguments
+) {
+    int stars[2] = { 0, 0 };
+    const Argument *value = &arguments[count - 1];
+
+    for (int i = 0; i < count - 1; ++i) stars[i] = arguments[i].i;
+
+#define PRINT(x) \
+    do { \
+        if (count == 1) printf(spec, x); \
+        else if (count == 2) printf(spec, stars[0], x); \
+        else printf(spec, stars[0], stars[1], x); \
+    } while (0)
+
+    switch (types[count - 1]) {
+        case LOG_ARG_INT     : PRINT(value->i); break;
+        case LOG_ARG_LONG    : PRINT((long)value->l); break;
+        case LOG_ARG_DOUBLE  : PRINT(value->d); break;
+        case LOG_ARG_POINTER : PRINT((void*)(uintptr_t)value->p); break;
+        case LOG_ARG_STRING  : PRINT(value->s); break;
+    }
+
+#undef PRINT
+}
+
+static bool decode_message(void) {
+    uint8_t level;
+    uint16_t id;
+    uint64_t timestamp;
+
+    if (!read_bytes(&level, 1) || !read_bytes(&id, 2) || !read_bytes(&timestamp, 8))
+        return false;
+    if (id >= MAX_FORMATS) return false;
+
+    double elapsed = (double)(int64_t)(timestamp - base_clock) / clock_frequency;
+    time_t seconds = base_seconds + (time_t)(base_nanoseconds / 1e9 + elapsed);
+
+    char *time_str = ctime(&seconds);
+    time_str[strlen(time_str) - 1] = '\0';
+    printf("[%s] [%s] ", time_str, level_string(level));
+
+    const char *p = formats[id];
+    while (*p != '\0') {
+        if (*p != '%') {
+            putchar(*p++);
+            continue;
+        }
+
+        char types[3], spec[64];
+        Argument arguments[3];
+        int count;
+        const char *end = scan_conversion(p, types, &count, NULL);
+
+        for (int i = 0; i < count; ++i)
+            if (!read_argument(types[i], &arguments[i])) return false;
+
+        if (count == 0) {
+            putchar('%');
+        } else {
+            size_t length = end - p < 63 ? end - p : 63;
+            memcpy(spec, p, length);
+            spec[length] = '\0';
+            print_conversion(spec, types, count, arguments);
+        }
+        p = end;
+    }
+    putchar('\n');
+    return true;
+}
+
+static bool decode_format(void) {
+    uint16_t id, length;
+
+    if (!read_bytes(&id, 2) || !read_bytes(&length, 2) || id >= MAX_FORMATS)
+        return false;
+
+    char *format = formats[id];
+    size_t kept = length < MAX_FORMAT_LENGTH ? length : MAX_FORMAT_LENGTH - 1;
+    if (!read_bytes(format, kept)) return false;
+    format[kept] = '\0';
+
+    for (size_t i = kept; i < length; ++i) getchar();
+    return true;
+}
+
+static bool decode_header(void) {
+    char magic[3];
+    uint32_t version;
+
+    // The 'J' of the magic number has already been read.
+    if (!read_bytes(magic, 3) || memcmp(magic, LOG_BINARY_MAGIC + 1, 3) != 0)
+        return false;
+    if (!read_bytes(&version, 4) || version != LOG_BINARY_VERSION) {
+        fprintf(stderr, "[Error] : Unsupported log version\n");
+        return false;
+    }
+    memset(formats, 0, sizeof(formats));
+    return read_bytes(&base_seconds, 8) &&
+        read_bytes(&base_nanoseconds, 8) &&
+        read_bytes(&base_clock, 8) &&
+        read_bytes(&clock_frequency, 8) &&
+        clock_frequency > 0;
+}
+
+int main(void) {
+    int tag;
+    bool valid = true;
+
+    while (valid && (tag = getchar()) != EOF) {
+        switch (tag) {
+            case 'J'                 : valid = decode_header(); break;
+            case LOG_RECORD_FORMAT   : valid = decode_format(); break;
+            case LOG_RECORD_MESSAGE  : valid = decode_message(); break;
+            default                  : valid = false;
+        }
+    }
+
+    if (!valid) {
+        fprintf(stderr, "[Error] : The log is truncated or corrupted\n");
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
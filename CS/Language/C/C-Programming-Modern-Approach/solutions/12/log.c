@@ -1,42 +1,507 @@
 #include "log.h"
 
+#include <pthread.h>
+#include <sched.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
+#include "log-binary.h"
 
 FILE *log_file = NULL;
+LogLevel log_level = LOG_MIN_LEVEL;
+
+// In asynchronous mode a message is formatted into a fixed-size record which
+// is put into a ring buffer, and a background thread turns the records into
+// lines of the log file. The caller never waits for the time, the file or
+// `fflush`, which is only called once for a whole batch of records.
+//
+// The ring buffer is lock-free: every slot has a sequence number telling whose
+// turn it is. A writer claims the slot at `tail` when its sequence equals the
+// position (the slot is free), fills it and sets the sequence to position + 1
+// (the slot is full). The background thread reads the slot at `head` once its
+// sequence is head + 1, and gives it back by setting it to head + capacity,
+// the position that will use the slot the next time around.
+
+#define LOG_RING_SIZE 8192      // ← Must be a power of two.
+#define LOG_MESSAGE_SIZE 240
+#define LOG_IDLE_NANOSECONDS 1000000
+
+typedef struct {
+    atomic_size_t sequence;
+    time_t time;
+    LogLevel level;
+    int size;       // ← The size of a binary record, 0 for a text message.
+    char message[LOG_MESSAGE_SIZE];
+} LogRecord;
+
+static bool is_async = false;
+static LogOverflowPolicy overflow_policy = LOG_DROP;
+static LogRecord ring[LOG_RING_SIZE];
+static atomic_size_t tail;
+static size_t head;
+static atomic_size_t num_of_dropped;
+static atomic_bool stopping;
+static pthread_t writer;
+
+static const char* level_string(LogLevel level) {
+    switch (level) {
+        case LOG_INFO     : return "info";
+        case LOG_WARNING  : return "warning";
+        case LOG_ERROR    : return "error";
+    }
+    return "";
+}
+
+// Writes `now` as `ctime` does, without its newline. `ctime` returns a static
+// buffer shared by every thread, so the callers of `log_message` and the
+// background thread would overwrite each other's times.
+
+static void format_time(char *time_str, size_t size, time_t now) {
+    struct tm local;
+    localtime_r(&now, &local);
+    strftime(time_str, size, "%a %b %e %H:%M:%S %Y", &local);
+}
+
+static void format_header(char *header, size_t size, time_t now, LogLevel level) {
+    char time_str[32];
+    format_time(time_str, sizeof(time_str), now);
+
+    snprintf(header, size, "[%s] [%s] ", time_str, level_string(level));
+}
+
+// Writes every full slot, then flushes the file. Returns the number of
+// records written.
+
+static size_t drain_ring(void) {
+    static char time_str[32];
+    static time_t last_time = -1;
+    size_t count = 0;
+
+    while (true) {
+        LogRecord *record = &ring[head & (LOG_RING_SIZE - 1)];
+        if (atomic_load_explicit(&record->sequence, memory_order_acquire) != head + 1)
+            break;
+
+        if (record->size > 0) {
+            fwrite(record->message, 1, record->size, log_file);
+        } else {
+            // Most records of a batch come from the same second.
+            if (record->time != last_time) {
+                last_time = record->time;
+                format_time(time_str, sizeof(time_str), last_time);
+            }
+            fprintf(
+                log_file, "[%s] [%s] %s\n",
+                time_str, level_string(record->level), record->message
+            );
+        }
+
+        atomic_store_explicit(
+            &record->sequence, head + LOG_RING_SIZE, memory_order_release
+        );
+        head++;
+        count++;
+    }
+
+    if (count > 0) fflush(log_file);
+    return count;
+}
+
+static void* write_records(void *argument) {
+    (void)argument;
+    struct timespec idle = { 0, LOG_IDLE_NANOSECONDS };
+
+    while (!atomic_load(&stopping)) {
+        if (drain_ring() == 0) nanosleep(&idle, NULL);
+    }
+    drain_ring();   // ← Whatever was put in before `stopping` was set.
+    return NULL;
+}
+
+// In binary mode nothing is formatted at all. A format string is given a
+// small id the first time it's seen (its address is the key of a hash table,
+// so finding it again costs a few instructions) and written to the log once.
+// After that a message only stores the id, a timestamp and the raw values of
+// its arguments, and `log-decode` does the formatting when the log is read.
+
+#define LOG_FORMAT_TABLE_SIZE 1024      // ← Must be a power of two.
+
+typedef struct {
+    const char *_Atomic format;
+    uint16_t id;
+    char types[LOG_MAX_ARGS];
+    int precisions[LOG_MAX_ARGS];   // ← Of the strings: at most that many characters are read.
+    int num_of_types;
+    int fixed_size;     // ← The size of the record without string characters.
+} LogFormatEntry;
+
+static LogFormat log_format = LOG_TEXT;
+static LogFormatEntry format_table[LOG_FORMAT_TABLE_SIZE];
+static int num_of_formats = 0;
+static pthread_mutex_t format_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static LogRecord* claim_record(LogOverflowPolicy policy);
+static void publish_record(LogRecord *record);
+
+// Messages are stamped with the cheapest clock there is: the time stamp
+// counter of the processor on x86-64, the monotonic clock elsewhere. The
+// session header says how the clock relates to the wall-clock time.
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+
+static uint64_t read_clock(void) {
+    return __rdtsc();
+}
+
+#define LOG_CALIBRATION_NANOSECONDS 2000000
+
+static uint64_t monotonic_nanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// Counts the ticks during a short interval of the monotonic clock.
+
+static uint64_t clock_frequency(void) {
+    uint64_t start = monotonic_nanoseconds(), start_ticks = __rdtsc();
+    uint64_t elapsed;
+
+    while ((elapsed = monotonic_nanoseconds() - start) < LOG_CALIBRATION_NANOSECONDS);
+    return (__rdtsc() - start_ticks) * 1000000000.0 / elapsed;
+}
+#else
+static uint64_t read_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static uint64_t clock_frequency(void) {
+    return 1000000000;
+}
+#endif
+
+static char* put_bytes(char *p, const void *data, size_t size) {
+    memcpy(p, data, size);
+    return p + size;
+}
+
+// Writes a binary record, through the ring buffer in asynchronous mode.
+// Returns false if it was dropped.
+
+static bool emit_binary(const char *data, int size, LogOverflowPolicy policy) {
+    if (!is_async) {
+        fwrite(data, 1, size, log_file);
+        return true;
+    }
+
+    LogRecord *record = claim_record(policy);
+    if (record == NULL) return false;
+    memcpy(record->message, data, size);
+    record->size = size;
+    publish_record(record);
+    return true;
+}
+
+static void write_binary_header(void) {
+    struct timespec now;
+    uint32_t version = LOG_BINARY_VERSION;
+    int64_t seconds, nanoseconds;
+    uint64_t frequency = clock_frequency();
+    uint64_t clock = read_clock();
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    seconds = now.tv_sec;
+    nanoseconds = now.tv_nsec;
+
+    fwrite(LOG_BINARY_MAGIC, 1, 4, log_file);
+    fwrite(&version, sizeof(version), 1, log_file);
+    fwrite(&seconds, sizeof(seconds), 1, log_file);
+    fwrite(&nanoseconds, sizeof(nanoseconds), 1, log_file);
+    fwrite(&clock, sizeof(clock), 1, log_file);
+    fwrite(&frequency, sizeof(frequency), 1, log_file);
+}
+
+static void register_format(LogFormatEntry *entry, const char *format) {
+    static const int sizes[128] = {
+        [LOG_ARG_INT] = 4, [LOG_ARG_LONG] = 8, [LOG_ARG_DOUBLE] = 8,
+        [LOG_ARG_POINTER] = 8, [LOG_ARG_STRING] = 1
+    };
+    char record[LOG_MESSAGE_SIZE];
+    char *p = record;
+    uint16_t length = strlen(format);
+
+    entry->id = num_of_formats++;
+    entry->num_of_types = 0;
+    entry->fixed_size = 12;
+
+    for (const char *next = format; *next != '\0'; ) {
+        if (*next != '%') {
+            next++;
+            continue;
+        }
+        char types[3];
+        int count, precision;
+        next = scan_conversion(next, types, &count, &precision);
+        for (int i = 0; i < count && entry->num_of_types < LOG_MAX_ARGS; ++i) {
+            entry->precisions[entry->num_of_types] = precision;
+            entry->types[entry->num_of_types++] = types[i];
+            entry->fixed_size += sizes[(int)types[i]];
+        }
+    }
+
+    if (length > LOG_MESSAGE_SIZE - 5) length = LOG_MESSAGE_SIZE - 5;
+    *p++ = LOG_RECORD_FORMAT;
+    p = put_bytes(p, &entry->id, 2);
+    p = put_bytes(p, &length, 2);
+    p = put_bytes(p, format, length);
+
+    // Every message using the format comes after this record, so it's never
+    // dropped.
+    emit_binary(record, p - record, LOG_BLOCK);
+}
+
+static const LogFormatEntry* find_format(const char *format) {
+    size_t slot = ((uintptr_t)format >> 3) & (LOG_FORMAT_TABLE_SIZE - 1);
+
+    while (true) {
+        LogFormatEntry *entry = &format_table[slot];
+        const char *key = atomic_load_explicit(&entry->format, memory_order_acquire);
+
+        if (key == format) return entry;
+        if (key == NULL) break;
+        slot = (slot + 1) & (LOG_FORMAT_TABLE_SIZE - 1);
+    }
+
+    // Not seen yet: look again while holding the lock, then add it.
+    pthread_mutex_lock(&format_lock);
+    slot = ((uintptr_t)format >> 3) & (LOG_FORMAT_TABLE_SIZE - 1);
+    while (format_table[slot].format != NULL && format_table[slot].format != format)
+        slot = (slot + 1) & (LOG_FORMAT_TABLE_SIZE - 1);
+
+    LogFormatEntry *entry = &format_table[slot];
+    if (entry->format == NULL) {
+        if (num_of_formats >= LOG_FORMAT_TABLE_SIZE / 2) {
+            pthread_mutex_unlock(&format_lock);
+            return NULL;
+        }
+        register_format(entry, format);
+        atomic_store_explicit(&entry->format, format, memory_order_release);
+    }
+    pthread_mutex_unlock(&format_lock);
+    return entry;
+}
+
+static int encode_message(
+    char *record, LogLevel level, const LogFormatEntry *entry, va_list args
+) {
+    char *p = record;
+    uint8_t level_byte = level;
+    uint64_t timestamp = read_clock();
+    int room = LOG_MESSAGE_SIZE - entry->fixed_size;
+    int32_t star = 0;     // ← The last int, which is the precision of a "%.*s".
+
+    *p++ = LOG_RECORD_MESSAGE;
+    p = put_bytes(p, &level_byte, 1);
+    p = put_bytes(p, &entry->id, 2);
+    p = put_bytes(p, &timestamp, 8);
+
+    for (int i = 0; i < entry->num_of_types; ++i) {
+        switch (entry->types[i]) {
+            case LOG_ARG_INT : {
+                int32_t value = va_arg(args, int);
+                p = put_bytes(p, &value, 4);
+                star = value;
+                break;
+            }
+            case LOG_ARG_LONG : {
+                int64_t value = va_arg(args, long);
+                p = put_bytes(p, &value, 8);
+                break;
+            }
+            case LOG_ARG_DOUBLE : {
+                double value = va_arg(args, double);
+                p = put_bytes(p, &value, 8);
+                break;
+            }
+            case LOG_ARG_POINTER : {
+                uint64_t value = (uintptr_t)va_arg(args, void*);
+                p = put_bytes(p, &value, 8);
+                break;
+            }
+            case LOG_ARG_STRING : {
+                const char *value = va_arg(args, const char*);
+                int precision = entry->precisions[i];
+                if (precision == LOG_PRECISION_STAR) precision = star;
+                if (value == NULL) value = "(null)";
+
+                // With a precision the string doesn't have to end with '\0'
+                // (a word in the text, say), so no more than it is read.
+                size_t length = precision >= 0 ? strnlen(value, precision) : strlen(value);
+                if (length > 255) length = 255;
+                if ((int)length > room) length = room;
+                room -= length;
+                *p++ = (uint8_t)length;
+                p = put_bytes(p, value, length);
+                break;
+            }
+        }
+    }
+    return p - record;
+}
+
+static void log_message_binary(LogLevel level, const char *format, va_list args) {
+    const LogFormatEntry *entry = find_format(format);
+    if (entry == NULL) {
+        atomic_fetch_add_explicit(&num_of_dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    if (!is_async) {
+        char record[LOG_MESSAGE_SIZE];
+        fwrite(record, 1, encode_message(record, level, entry, args), log_file);
+        return;
+    }
+
+    LogRecord *record = claim_record(overflow_policy);
+    if (record == NULL) return;
+    record->size = encode_message(record->message, level, entry, args);
+    publish_record(record);
+}
+
+void log_set_format(LogFormat format) {
+    log_format = format;
+}
 
 void log_init(const char *log_filename) {
-    log_file = fopen(log_filename, "a");
+    log_file = fopen(log_filename, log_format == LOG_BINARY ? "ab" : "a");
     if (!log_file) {
         fprintf(stderr, "ERROR: Cannot open a log file!\n");
+        return;
+    }
+    if (log_format == LOG_BINARY) {
+        // Format ids are only valid within one session of the log.
+        memset(format_table, 0, sizeof(format_table));
+        num_of_formats = 0;
+        write_binary_header();
+    }
+}
+
+void log_init_async(const char *log_filename, LogOverflowPolicy policy) {
+    log_init(log_filename);
+    if (!log_file) return;
+
+    for (size_t i = 0; i < LOG_RING_SIZE; ++i)
+        atomic_init(&ring[i].sequence, i);
+    atomic_init(&tail, 0);
+    atomic_init(&num_of_dropped, 0);
+    atomic_init(&stopping, false);
+    head = 0;
+    overflow_policy = policy;
+
+    if (pthread_create(&writer, NULL, write_records, NULL) != 0) {
+        fprintf(stderr, "ERROR: Cannot start the log thread, logging synchronously!\n");
+        return;
     }
+    is_async = true;
 }
 
 void log_close(void) {
+    if (is_async) {
+        atomic_store(&stopping, true);
+        pthread_join(writer, NULL);
+        is_async = false;
+
+    }
+
+    size_t dropped = atomic_load(&num_of_dropped);
+    if (dropped > 0 && log_file) {
+        atomic_store(&num_of_dropped, 0);
+        log_message(LOG_WARNING, "%zu messages were dropped", dropped);
+    }
     if (log_file) fclose(log_file);
+    log_file = NULL;
 }
 
-void log_message(LogLevel level, const char *format, ...) {
-    time_t now;
-    time(&now);
-    char *time_str = ctime(&now);
-    time_str[strlen(time_str) - 1] = '\0';
+// Claims a free slot, or returns NULL if the ring is full and messages are
+// dropped.
 
-    const char *level_str;
+static LogRecord* claim_record(LogOverflowPolicy policy) {
+    size_t position = atomic_load_explicit(&tail, memory_order_relaxed);
 
-    switch (level) {
-        case LOG_INFO     : level_str = "info";     break;
-        case LOG_WARNING  : level_str = "warning";  break;
-        case LOG_ERROR    : level_str = "error";    break;
+    while (true) {
+        LogRecord *record = &ring[position & (LOG_RING_SIZE - 1)];
+        size_t sequence = atomic_load_explicit(&record->sequence, memory_order_acquire);
+
+        if (sequence == position) {
+            if (atomic_compare_exchange_weak_explicit(
+                    &tail, &position, position + 1,
+                    memory_order_relaxed, memory_order_relaxed))
+                return record;
+        } else if ((long)(sequence - position) < 0) {
+            // The slot still holds the record from one lap ago: the ring is full.
+            if (policy == LOG_DROP) {
+                atomic_fetch_add_explicit(&num_of_dropped, 1, memory_order_relaxed);
+                return NULL;
+            }
+            sched_yield();
+            position = atomic_load_explicit(&tail, memory_order_relaxed);
+        } else {
+            position = atomic_load_explicit(&tail, memory_order_relaxed);
+        }
     }
+}
 
-    char header[256];
-    snprintf(header, sizeof(header), "[%s] [%s] ", time_str, level_str);
+static void publish_record(LogRecord *record) {
+    size_t position = atomic_load_explicit(&record->sequence, memory_order_relaxed);
+    atomic_store_explicit(&record->sequence, position + 1, memory_order_release);
+}
+
+static void log_message_async(LogLevel level, const char *format, va_list args) {
+    LogRecord *record = claim_record(overflow_policy);
+    if (record == NULL) return;
+
+    record->time = time(NULL);
+    record->level = level;
+    record->size = 0;
+    vsnprintf(record->message, LOG_MESSAGE_SIZE, format, args);
+    publish_record(record);
+}
 
+void log_set_level(LogLevel level) {
+    log_level = level;
+}
+
+void log_message(LogLevel level, const char *format, ...) {
     va_list args;
 
+    if (!LOG_ENABLED(level)) return;
+
+    if (log_format == LOG_BINARY) {
+        if (!log_file) return;
+        va_start(args, format);
+        log_message_binary(level, format, args);
+        va_end(args);
+        return;
+    }
+    if (is_async) {
+        va_start(args, format);
+        log_message_async(level, format, args);
+        va_end(args);
+        return;
+    }
+
+    char header[256];
+    time_t now;
+    time(&now);
+    format_header(header, sizeof(header), now, level);
+
     if (log_file) {
         fprintf(log_file, "%s", header);
         va_start(args, format);
@@ -7,8 +7,79 @@ typedef enum {
     LOG_ERROR
 } LogLevel;
 
+// What `log_message` does in asynchronous mode when the ring buffer is full:
+// throw the message away (and count it), or wait for the background thread to
+// make room.
+
+typedef enum {
+    LOG_DROP,
+    LOG_BLOCK
+} LogOverflowPolicy;
+
+// How the messages are written: as lines of text, or as binary records which
+// are cheaper to write and are turned into text later by `log-decode` (see
+// `log-binary.h`).
+
+typedef enum {
+    LOG_TEXT,
+    LOG_BINARY
+} LogFormat;
+
+/*!
+ * @remark Selects the format used by the following `log_init` or
+ * `log_init_async`. The default is LOG_TEXT.
+ */
+void log_set_format(LogFormat format);
+
 void log_init(const char *log_filename);
+
+/*!
+ * @param [in] [log_filename] The file the messages are appended to.
+ * @param [in] [policy] What to do when the ring buffer is full.
+ * @remark Like `log_init`, but `log_message` only puts the message into a ring
+ * buffer and a background thread writes the messages to the file in batches.
+ * `log_close` waits until every message in the buffer has been written.
+ */
+void log_init_async(const char *log_filename, LogOverflowPolicy policy);
+
 void log_close(void);
 void log_message(LogLevel level, const char *format, ...);
 
+// Messages below a level are filtered twice:
+//
+//   [+] At compile time by LOG_MIN_LEVEL (gcc -DLOG_MIN_LEVEL=LOG_WARNING).
+//       The condition of `LOG` is then a constant false for lower levels, so
+//       the call is removed from the program altogether;
+//   [+] At run time by `log_set_level`, checked before the arguments of the
+//       message are evaluated.
+//
+// `LOG_SAMPLED` additionally writes only one message in `n` from the same
+// place in the program (counted per thread), for messages written so often
+// that a sample of them is enough.
+
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_INFO
+#endif
+
+extern LogLevel log_level;
+
+/*!
+ * @remark Ignores messages with a level lower than `level` from now on.
+ */
+void log_set_level(LogLevel level);
+
+#define LOG_ENABLED(level) ((level) >= LOG_MIN_LEVEL && (level) >= log_level)
+
+#define LOG(level, ...) \
+    do { \
+        if (LOG_ENABLED(level)) log_message((level), __VA_ARGS__); \
+    } while (0)
+
+#define LOG_SAMPLED(level, n, ...) \
+    do { \
+        static _Thread_local unsigned long log_count_; \
+        if (LOG_ENABLED(level) && log_count_++ % (n) == 0) \
+            log_message((level), __VA_ARGS__); \
+    } while (0)
+
 #endif
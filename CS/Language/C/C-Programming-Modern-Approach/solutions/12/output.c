@@ -0,0 +1,105 @@
+#include "output.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// `putchar` goes through the stdio buffer one character at a time, which
+// means a function call, a lock and a check for a full buffer per character.
+// Here a line is built directly in the output buffer and the buffer is handed
+// to the kernel in large pieces.
+
+#define DIRECT_WRITE_SIZE (1 << 16)
+
+static Output standard = { .fd = -1 };
+
+void output_init(Output *output, int fd, size_t flush_size) {
+    output->fd = fd;
+    output->data = NULL;
+    output->length = 0;
+    output->capacity = 0;
+    output->flush_size = flush_size;
+}
+
+// Writes all the pieces, continuing after a write that was interrupted or
+// only wrote some of the bytes.
+
+static void write_all(int fd, struct iovec *pieces, int count) {
+    while (count > 0) {
+        ssize_t written = writev(fd, pieces, count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            perror("[Error] : writev failed in <function:write_all>");
+            exit(EXIT_FAILURE);
+        }
+
+        while (count > 0 && (size_t)written >= pieces->iov_len) {
+            written -= pieces->iov_len;
+            pieces++;
+            count--;
+        }
+        if (count > 0) {
+            pieces->iov_base = (char*)pieces->iov_base + written;
+            pieces->iov_len -= written;
+        }
+    }
+}
+
+Output* standard_output(void) {
+    if (standard.fd < 0) output_init(&standard, STDOUT_FILENO, OUTPUT_FLUSH_SIZE);
+    return &standard;
+}
+
+void output_flush(Output *output) {
+    if (output->fd < 0 || output->length == 0) return;
+
+    struct iovec piece = { output->data, output->length };
+    write_all(output->fd, &piece, 1);
+    output->length = 0;
+}
+
+void output_close(Output *output) {
+    output_flush(output);
+    free(output->data);
+    output->data = NULL;
+    output->capacity = 0;
+}
+
+char* output_reserve(Output *output, size_t size) {
+    if (output->length + size > output->capacity) {
+        size_t capacity = output->capacity > 0 ? output->capacity : 4096;
+        while (capacity < output->length + size) capacity *= 2;
+
+        char *larger = (char*)realloc(output->data, capacity);
+        if (larger == NULL) {
+            fprintf(stderr, "[Error] : realloc failed in <function:output_reserve>\n");
+            exit(EXIT_FAILURE);
+        }
+        output->data = larger;
+        output->capacity = capacity;
+    }
+    return output->data + output->length;
+}
+
+void output_commit(Output *output, size_t size) {
+    output->length += size;
+    if (output->fd >= 0 && output->length >= output->flush_size)
+        output_flush(output);
+}
+
+void output_write(Output *output, const char *data, size_t size) {
+    if (output->fd >= 0 && size >= DIRECT_WRITE_SIZE) {
+        struct iovec pieces[2] = {
+            { output->data, output->length },
+            { (void*)data, size }
+        };
+        write_all(output->fd, pieces, 2);
+        output->length = 0;
+        return;
+    }
+
+    memcpy(output_reserve(output, size), data, size);
+    output_commit(output, size);
+}
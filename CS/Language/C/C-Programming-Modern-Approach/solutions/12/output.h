@@ -0,0 +1,62 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+
+#define OUTPUT_FLUSH_SIZE (1 << 20)
+
+// Finished lines are collected in a buffer and written with one system call
+// when the buffer holds `flush_size` bytes (a `flush_size` of 0 writes every
+// line as soon as it's finished). An output with `fd` -1 only collects lines
+// in memory and is never written.
+
+typedef struct {
+    int fd;
+    char *data;
+    size_t length;
+    size_t capacity;
+    size_t flush_size;
+} Output;
+
+/*!
+ * @param [out] [output] The output to initialize.
+ * @param [in] [fd] The file descriptor to write to, or -1 to only collect.
+ * @param [in] [flush_size] How many bytes to collect before writing.
+ */
+void output_init(Output *output, int fd, size_t flush_size);
+
+/*!
+ * @remark Returns the output shared by everything written to the standard
+ * output. Its `flush_size` may be changed before it's used.
+ */
+Output* standard_output(void);
+
+/*!
+ * @remark Writes what's left in the buffer and releases it.
+ */
+void output_close(Output *output);
+
+/*!
+ * @remark Returns a pointer to room for at least `size` more bytes at the end
+ * of the buffer. Nothing is added until `output_commit` is called.
+ */
+char* output_reserve(Output *output, size_t size);
+
+/*!
+ * @remark Adds the `size` bytes written to the reserved room to the buffer,
+ * and writes the buffer if the flush policy says so.
+ */
+void output_commit(Output *output, size_t size);
+
+/*!
+ * @remark Adds `size` bytes from `data` to the output. Large data is written
+ * together with the buffer by one `writev` instead of being copied.
+ */
+void output_write(Output *output, const char *data, size_t size);
+
+/*!
+ * @remark Writes everything in the buffer.
+ */
+void output_flush(Output *output);
+
+#endif
@@ -0,0 +1,191 @@
+#include "paragraph.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The greedy algorithm in `justify.c` puts as many words on a line as fit and
+// never looks back, so a short word left over at the end of one line can make
+// the next line very loose. Knuth and Plass instead consider every way to
+// break a paragraph into lines and pick the one with the smallest total
+// *badness*, where the badness of a line grows with the square of the spaces
+// left over at its end (the last line of a paragraph is never bad).
+//
+// Let `cost[j]` be the smallest total badness of the first j words, then
+//
+//   cost[j] = min { cost[i] + badness(i, j) }    for every i whose line fits
+//
+// where the words i..j-1 form the last line. A line holds at most
+// `width / 2 + 1` words (every word takes a character and a space), so only
+// that many values of i need to be tried and the whole computation is linear.
+//
+// To keep memory bounded the paragraph is handled in windows of
+// `WINDOW_WORDS` words. The breaks are computed for the whole window as if it
+// ended the paragraph, but only the lines ending at least `LOOKAHEAD_WORDS`
+// words before the end of the window are written; the rest is carried over to
+// the next window where more of the paragraph is known.
+
+#define WINDOW_WORDS 4096
+#define LOOKAHEAD_WORDS 512
+
+static void* allocate(size_t size) {
+    void *memory = malloc(size);
+    if (memory == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:paragraph_init>\n");
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+void paragraph_init(Paragraph *paragraph, Line *line) {
+    paragraph->line = line;
+    paragraph->words = allocate(WINDOW_WORDS * sizeof(WordSpan));
+    paragraph->num_of_words = 0;
+
+    paragraph->arena_capacity = 1 << 16;
+    paragraph->arena = allocate(paragraph->arena_capacity);
+    paragraph->arena_length = 0;
+
+    paragraph->cost = allocate((WINDOW_WORDS + 1) * sizeof(long));
+    paragraph->prefix = allocate((WINDOW_WORDS + 1) * sizeof(int));
+    paragraph->breaks = allocate((WINDOW_WORDS + 1) * sizeof(int));
+}
+
+void paragraph_free(Paragraph *paragraph) {
+    free(paragraph->words);
+    free(paragraph->arena);
+    free(paragraph->cost);
+    free(paragraph->prefix);
+    free(paragraph->breaks);
+    paragraph->words = NULL;
+    paragraph->arena = NULL;
+}
+
+// prefix[j] is the total width of the first j words, and breaks[j] is where
+// the last line of cost[j] starts.
+
+static void compute_breaks(Paragraph *paragraph, bool is_final) {
+    const WordSpan *words = paragraph->words;
+    int num_of_words = paragraph->num_of_words;
+    int width = paragraph->line->width;
+    long *cost = paragraph->cost;
+    int *prefix = paragraph->prefix, *breaks = paragraph->breaks;
+
+    prefix[0] = 0;
+    for (int j = 0; j < num_of_words; ++j)
+        prefix[j + 1] = prefix[j] + words[j].width;
+
+    cost[0] = 0;
+    for (int j = 1; j <= num_of_words; ++j) {
+        cost[j] = -1;
+        for (int i = j - 1; i >= 0; --i) {
+            int length = prefix[j] - prefix[i] + (j - i - 1);
+            if (length > width && i < j - 1) break;
+
+            long slack = width - length;
+            long badness = (j == num_of_words && is_final) ? 0 : slack * slack;
+            if (cost[j] < 0 || cost[i] + badness < cost[j]) {
+                cost[j] = cost[i] + badness;
+                breaks[j] = i;
+            }
+        }
+    }
+}
+
+static void emit_line(Paragraph *paragraph, int from, int to) {
+    line_clear(paragraph->line);
+    for (int i = from; i < to; ++i) {
+        const WordSpan *word = &paragraph->words[i];
+        line_add_word_width(
+            paragraph->line, paragraph->arena + word->offset, word->length, word->width
+        );
+    }
+}
+
+// Writes the lines of the optimal breaking that end at or before the word
+// `limit`, and returns the index of the first word that was not written. With
+// `at_least_one` the first line is written even if it ends after `limit`.
+
+static int commit_lines(Paragraph *paragraph, int limit, bool at_least_one) {
+    int *breaks = paragraph->breaks;
+    int num_of_words = paragraph->num_of_words;
+    int starts[WINDOW_WORDS];
+    int num_of_lines = 0;
+
+    for (int j = num_of_words; j > 0; j = breaks[j])
+        starts[num_of_lines++] = breaks[j];
+
+    // starts[] lists the beginning of each line from the last line backward.
+
+    int end = 0;
+    for (int k = num_of_lines - 1; k >= 0; --k) {
+        int next = k > 0 ? starts[k - 1] : num_of_words;
+        if (next > limit && !(at_least_one && end == 0)) break;
+        emit_line(paragraph, starts[k], next);
+        line_write(paragraph->line);
+        end = next;
+    }
+    return end;
+}
+
+static void discard_words(Paragraph *paragraph, int count) {
+    WordSpan *words = paragraph->words;
+    if (count == 0) return;
+
+    int kept_offset = count < paragraph->num_of_words
+        ? words[count].offset : paragraph->arena_length;
+    memmove(
+        paragraph->arena, paragraph->arena + kept_offset,
+        paragraph->arena_length - kept_offset
+    );
+    paragraph->arena_length -= kept_offset;
+
+    for (int i = count; i < paragraph->num_of_words; ++i) {
+        words[i - count].offset = words[i].offset - kept_offset;
+        words[i - count].length = words[i].length;
+        words[i - count].width = words[i].width;
+    }
+    paragraph->num_of_words -= count;
+}
+
+void paragraph_add_word(Paragraph *paragraph, const char *word, int length, int width) {
+    // When the width holds more than LOOKAHEAD_WORDS words no line may end
+    // before the lookahead, but the window has to shrink all the same: its
+    // first line is written then, chosen with what the window knows.
+    if (paragraph->num_of_words == WINDOW_WORDS) {
+        compute_breaks(paragraph, false);
+        discard_words(paragraph, commit_lines(paragraph, WINDOW_WORDS - LOOKAHEAD_WORDS, true));
+    }
+
+    if (paragraph->arena_length + length > paragraph->arena_capacity) {
+        int capacity = paragraph->arena_capacity * 2;
+        while (capacity < paragraph->arena_length + length) capacity *= 2;
+
+        char *larger = (char*)realloc(paragraph->arena, capacity);
+        if (larger == NULL) {
+            fprintf(stderr, "[Error] : realloc failed in <function:paragraph_add_word>\n");
+            exit(EXIT_FAILURE);
+        }
+        paragraph->arena = larger;
+        paragraph->arena_capacity = capacity;
+    }
+
+    WordSpan *span = &paragraph->words[paragraph->num_of_words++];
+    memcpy(paragraph->arena + paragraph->arena_length, word, length);
+    span->offset = paragraph->arena_length;
+    span->length = length;
+    span->width = width;
+    paragraph->arena_length += length;
+}
+
+void paragraph_flush(Paragraph *paragraph) {
+    if (paragraph->num_of_words == 0) {
+        line_clear(paragraph->line);
+        return;
+    }
+
+    compute_breaks(paragraph, true);
+    int last = commit_lines(paragraph, paragraph->breaks[paragraph->num_of_words], false);
+    emit_line(paragraph, last, paragraph->num_of_words);
+    discard_words(paragraph, paragraph->num_of_words);
+}
@@ -0,0 +1,54 @@
+#ifndef PARAGRAPH_H
+#define PARAGRAPH_H
+
+#include "line.h"
+
+// A paragraph being broken into lines by minimizing its total badness. The
+// words wait here until enough words follow them to be sure of the choice,
+// then they are written line by line through `line`.
+
+typedef struct {
+    Line *line;
+
+    WordSpan *words;
+    int num_of_words;
+
+    char *arena;
+    int arena_length;
+    int arena_capacity;
+
+    long *cost;
+    int *prefix;
+    int *breaks;
+} Paragraph;
+
+/*!
+ * @param [out] [paragraph] The paragraph to initialize.
+ * @param [in] [line] The line the paragraph is written through.
+ * @remark Allocates the memory of the paragraph, which stays the same size
+ * however long the paragraph is.
+ */
+void paragraph_init(Paragraph *paragraph, Line *line);
+
+/*!
+ * @remark Releases the memory of the paragraph.
+ */
+void paragraph_free(Paragraph *paragraph);
+
+/*!
+ * @param [in] [word] The input word, `length` bytes long and `width` columns
+ * wide.
+ * @remark Appends word to the buffered paragraph. Lines are chosen by
+ * minimizing the total badness of the paragraph instead of greedily, and are
+ * written with `line_write` once enough words follow them to be sure of the
+ * choice.
+ */
+void paragraph_add_word(Paragraph *paragraph, const char *word, int length, int width);
+
+/*!
+ * @remark Writes the rest of the buffered paragraph with justification, except
+ * for the last line which is left in the line for `line_flush`.
+ */
+void paragraph_flush(Paragraph *paragraph);
+
+#endif
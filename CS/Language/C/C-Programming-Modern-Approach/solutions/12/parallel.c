@@ -0,0 +1,247 @@
+#include "parallel.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "line.h"
+#include "log.h"
+#include "word.h"
+
+// The input is cut into chunks which are justified by different threads, each
+// with its own `Line`, and the results are written in the original order.
+//
+// Newlines in the input are read as spaces, so the words of the whole input
+// flow into each other and there's no boundary at which the sequential program
+// is guaranteed to start a new line. A worker therefore *guesses* that a new
+// line starts at the first word of its chunk, and records where each of its
+// lines starts. When the chunks are joined, the line left open at the end of
+// the previous chunk keeps being filled with the words of the next chunk,
+// exactly as the sequential program would, until it starts a new line at a
+// word where the worker also started one. From there on the greedy algorithm
+// makes the same decisions as the worker did, so the rest of the worker's
+// output is used as it is. In practice this happens within a line or two.
+
+#define CHUNK_SIZE (1 << 20)
+#define CHUNKS_PER_THREAD 4
+
+typedef struct {
+    const char *begin;
+    const char *end;
+
+    Output output;
+
+    int *starts;        // ← The index of the first word of each line.
+    long *offsets;      // ← Where each line starts in `output`.
+    int num_of_lines;
+    int capacity;
+
+    const char *open_line;  // ← The first word of the line left open.
+    bool done;
+} Chunk;
+
+static Chunk *chunks = NULL;
+static int num_of_chunks = 0;
+static int next_chunk = 0;
+static bool stopping = false;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t chunk_done = PTHREAD_COND_INITIALIZER;
+
+// Copies the word and truncates it the same way `justify.c` does. Returns the
+// length used to decide whether the word fits on the line.
+
+static int prepare_word(char *word, const char *span, int length) {
+    if (length > MAX_WORD_LENGTH + 1) length = MAX_WORD_LENGTH + 1;
+    memcpy(word, span, length);
+    word[length] = '\0';
+    if (length > MAX_WORD_LENGTH) word[MAX_WORD_LENGTH] = '*';
+    return length;
+}
+
+static void record_line(Chunk *chunk, int start, long offset) {
+    if (chunk->num_of_lines == chunk->capacity) {
+        chunk->capacity = chunk->capacity > 0 ? chunk->capacity * 2 : 1024;
+        chunk->starts = (int*)realloc(chunk->starts, chunk->capacity * sizeof(int));
+        chunk->offsets = (long*)realloc(chunk->offsets, chunk->capacity * sizeof(long));
+        if (chunk->starts == NULL || chunk->offsets == NULL) {
+            fprintf(stderr, "[Error] : realloc failed in <function:record_line>\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    chunk->starts[chunk->num_of_lines] = start;
+    chunk->offsets[chunk->num_of_lines] = offset;
+    chunk->num_of_lines++;
+}
+
+static void justify_chunk(Chunk *chunk) {
+    Line line;
+    char word[MAX_WORD_LENGTH + 2];
+    const char *cursor = chunk->begin, *span;
+    int length, index = 0;
+
+    chunk->output.length = 0;
+    line_init(&line, &chunk->output, get_line_width());
+    chunk->num_of_lines = 0;
+    chunk->open_line = chunk->begin;
+    record_line(chunk, 0, 0);
+
+    while ((length = scan_word(&cursor, chunk->end, &span)) > 0) {
+        int word_length = prepare_word(word, span, length);
+
+        if (line.num_of_words > 0 && word_length + 1 > line_space_remaining(&line)) {
+            line_write(&line);
+            line_clear(&line);
+            record_line(chunk, index, chunk->output.length);
+            chunk->open_line = span;
+        }
+
+        line_add_word(&line, word, word_length);
+        index++;
+    }
+    line_free(&line);
+}
+
+static void* worker(void *argument) {
+    (void)argument;
+
+    pthread_mutex_lock(&lock);
+    while (true) {
+        while (next_chunk >= num_of_chunks && !stopping)
+            pthread_cond_wait(&work_ready, &lock);
+        if (next_chunk >= num_of_chunks) break;
+
+        Chunk *chunk = &chunks[next_chunk++];
+        pthread_mutex_unlock(&lock);
+
+        justify_chunk(chunk);
+
+        pthread_mutex_lock(&lock);
+        chunk->done = true;
+        pthread_cond_broadcast(&chunk_done);
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+// Joins a justified chunk to the output. `carry` is the line left open by the
+// chunks before it.
+
+static void join_chunk(Line *carry, Chunk *chunk) {
+    char word[MAX_WORD_LENGTH + 2];
+    const char *cursor = chunk->begin, *span;
+    int length, index = 0, line = 0;
+    bool synchronized = carry->num_of_words == 0;
+
+    while (!synchronized && (length = scan_word(&cursor, chunk->end, &span)) > 0) {
+        int word_length = prepare_word(word, span, length);
+
+        if (carry->num_of_words > 0 && word_length + 1 > line_space_remaining(carry)) {
+            line_write(carry);
+            line_clear(carry);
+
+            while (line < chunk->num_of_lines && chunk->starts[line] < index)
+                line++;
+            if (line < chunk->num_of_lines && chunk->starts[line] == index) {
+                synchronized = true;
+                break;
+            }
+        }
+
+        line_add_word(carry, word, word_length);
+        index++;
+    }
+    if (!synchronized) return;
+
+    output_write(
+        carry->out, chunk->output.data + chunk->offsets[line],
+        chunk->output.length - chunk->offsets[line]
+    );
+
+    line_clear(carry);
+    cursor = chunk->open_line;
+    while ((length = scan_word(&cursor, chunk->end, &span)) > 0) {
+        int word_length = prepare_word(word, span, length);
+        line_add_word(carry, word, word_length);
+    }
+}
+
+static int split_block(const char *block, size_t size, int max_chunks) {
+    size_t target = size / max_chunks + 1;
+    const char *end = block + size;
+    int count = 0;
+
+    while (block < end) {
+        const char *cut = end - block > (long)target ? block + target : end;
+        while (cut < end && *cut != ' ' && *cut != '\n' && *cut != '\t') cut++;
+
+        chunks[count].begin = block;
+        chunks[count].end = cut;
+        chunks[count].done = false;
+        count++;
+        block = cut;
+    }
+    return count;
+}
+
+void justify_parallel(int num_of_threads) {
+    int max_chunks = num_of_threads * CHUNKS_PER_THREAD;
+    pthread_t *threads = (pthread_t*)malloc(num_of_threads * sizeof(pthread_t));
+    chunks = (Chunk*)calloc(max_chunks, sizeof(Chunk));
+    if (threads == NULL || chunks == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:justify_parallel>\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < max_chunks; ++i)
+        output_init(&chunks[i].output, -1, 0);
+
+    for (int i = 0; i < num_of_threads; ++i) {
+        if (pthread_create(&threads[i], NULL, worker, NULL) != 0) {
+            fprintf(stderr, "[Error] : pthread_create failed in <function:justify_parallel>\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    Line carry;
+    const char *block;
+    size_t size;
+
+    line_init(&carry, standard_output(), get_line_width());
+
+    while ((size = next_block(&block, (size_t)max_chunks * CHUNK_SIZE)) > 0) {
+        pthread_mutex_lock(&lock);
+        num_of_chunks = split_block(block, size, max_chunks);
+        next_chunk = 0;
+        pthread_cond_broadcast(&work_ready);
+        pthread_mutex_unlock(&lock);
+
+        for (int i = 0; i < num_of_chunks; ++i) {
+            pthread_mutex_lock(&lock);
+            while (!chunks[i].done) pthread_cond_wait(&chunk_done, &lock);
+            pthread_mutex_unlock(&lock);
+
+            join_chunk(&carry, &chunks[i]);
+        }
+        LOG(LOG_INFO, "Justified %zu bytes in %d chunks", size, num_of_chunks);
+    }
+
+    line_flush(&carry);
+    line_free(&carry);
+
+    pthread_mutex_lock(&lock);
+    stopping = true;
+    pthread_cond_broadcast(&work_ready);
+    pthread_mutex_unlock(&lock);
+
+    for (int i = 0; i < num_of_threads; ++i)
+        pthread_join(threads[i], NULL);
+
+    for (int i = 0; i < max_chunks; ++i) {
+        output_close(&chunks[i].output);
+        free(chunks[i].starts);
+        free(chunks[i].offsets);
+    }
+    free(chunks);
+    free(threads);
+}
@@ -0,0 +1,14 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+/*!
+ * @param [in] [num_of_threads] The number of worker threads.
+ * @remark Justifies the whole input with a pool of worker threads and writes
+ * the result to the standard output. The output is the same as the one of
+ * the sequential loop in `justify.c`, but the words aren't logged: the
+ * workers read them in no particular order, and a message per word would
+ * cost more than justifying it.
+ */
+void justify_parallel(int num_of_threads);
+
+#endif
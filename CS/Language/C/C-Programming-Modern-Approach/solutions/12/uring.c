@@ -0,0 +1,140 @@
+#include "uring.h"
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// There's no io_uring wrapper in the C library (liburing is a separate
+// library), so the rings are mapped by hand as described in io_uring(7). The
+// kernel reads the tail of the submission ring and writes the tail of the
+// completion ring, so these are accessed with acquire and release ordering:
+// the entries must be written before the new tail is seen, and read after.
+
+static int setup(unsigned entries, struct io_uring_params *params) {
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+bool uring_init(Uring *ring, unsigned entries) {
+    struct io_uring_params params;
+
+    memset(ring, 0, sizeof(Uring));
+    memset(&params, 0, sizeof(params));
+    ring->fd = setup(entries, &params);
+    if (ring->fd < 0) return false;
+
+    ring->sq_map_length = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_length = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_map_length > ring->sq_map_length) ring->sq_map_length = ring->cq_map_length;
+        ring->cq_map_length = ring->sq_map_length;
+    }
+
+    ring->sq_map = mmap(
+        NULL, ring->sq_map_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        ring->fd, IORING_OFF_SQ_RING
+    );
+    if (ring->sq_map == MAP_FAILED) {
+        close(ring->fd);
+        return false;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_map = ring->sq_map;
+    } else {
+        ring->cq_map = mmap(
+            NULL, ring->cq_map_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ring->fd, IORING_OFF_CQ_RING
+        );
+        if (ring->cq_map == MAP_FAILED) {
+            munmap(ring->sq_map, ring->sq_map_length);
+            close(ring->fd);
+            return false;
+        }
+    }
+
+    ring->sqes_map_length = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes_map = mmap(
+        NULL, ring->sqes_map_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        ring->fd, IORING_OFF_SQES
+    );
+    if (ring->sqes_map == MAP_FAILED) {
+        if (ring->cq_map != ring->sq_map) munmap(ring->cq_map, ring->cq_map_length);
+        munmap(ring->sq_map, ring->sq_map_length);
+        close(ring->fd);
+        return false;
+    }
+
+    char *sq = ring->sq_map, *cq = ring->cq_map;
+    ring->sq_head = (unsigned*)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    ring->sqes = ring->sqes_map;
+    ring->cqes = cq + params.cq_off.cqes;
+    ring->num_of_entries = params.sq_entries;
+    return true;
+}
+
+void uring_exit(Uring *ring) {
+    munmap(ring->sqes_map, ring->sqes_map_length);
+    if (ring->cq_map != ring->sq_map) munmap(ring->cq_map, ring->cq_map_length);
+    munmap(ring->sq_map, ring->sq_map_length);
+    close(ring->fd);
+}
+
+bool uring_read(Uring *ring, int fd, void *buffer, unsigned length, uint64_t offset, uint64_t user_data) {
+    if (ring->to_submit + ring->in_flight >= ring->num_of_entries) return false;
+
+    unsigned tail = *ring->sq_tail;
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = (struct io_uring_sqe*)ring->sqes + index;
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buffer;
+    sqe->len = length;
+    sqe->off = offset;
+    sqe->user_data = user_data;
+    ring->sq_array[index] = index;
+
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->to_submit++;
+    return true;
+}
+
+bool uring_wait(Uring *ring, uint64_t *user_data, int *result) {
+    if (ring->to_submit + ring->in_flight == 0) return false;
+
+    while (true) {
+        unsigned head = *ring->cq_head;
+        if (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+            struct io_uring_cqe *cqe = (struct io_uring_cqe*)ring->cqes + (head & *ring->cq_mask);
+            *user_data = cqe->user_data;
+            *result = cqe->res;
+            __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+            ring->in_flight--;
+            return true;
+        }
+
+        int submitted = enter(ring->fd, ring->to_submit, 1, IORING_ENTER_GETEVENTS);
+        if (submitted < 0) {
+            if (errno == EINTR) continue;
+            // Nothing can be completed any more, give the reads back as failed.
+            *user_data = 0;
+            *result = -errno;
+            return false;
+        }
+        ring->to_submit -= submitted;
+        ring->in_flight += submitted;
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A minimal io_uring, set up with the system calls directly: reads are queued
+// in a ring shared with the kernel and their results come back in another
+// one, so many reads are in flight with one system call and the thread does
+// other work while they complete.
+
+typedef struct {
+    int fd;
+
+    void *sq_map;
+    size_t sq_map_length;
+    void *cq_map;
+    size_t cq_map_length;
+    void *sqes_map;
+    size_t sqes_map_length;
+
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    void *sqes;
+    void *cqes;
+
+    unsigned num_of_entries;
+    unsigned to_submit;     // ← Queued but not yet given to the kernel.
+    unsigned in_flight;     // ← Given to the kernel but not yet completed.
+} Uring;
+
+/*!
+ * @param [in] [entries] The most reads in flight at the same time.
+ * @remark Sets up a ring. Returns false if the kernel doesn't support
+ * io_uring (or forbids it), then `pread` has to be used instead.
+ */
+bool uring_init(Uring *ring, unsigned entries);
+
+/*!
+ * @remark Releases the ring.
+ */
+void uring_exit(Uring *ring);
+
+/*!
+ * @param [in] [user_data] Given back with the result of the read.
+ * @remark Queues a read of `length` bytes at `offset` of `fd` into `buffer`.
+ * Returns false if the ring is full.
+ */
+bool uring_read(Uring *ring, int fd, void *buffer, unsigned length, uint64_t offset, uint64_t user_data);
+
+/*!
+ * @param [out] [user_data] The `user_data` of the completed read.
+ * @param [out] [result] The number of bytes read, or minus an errno value.
+ * @remark Submits the queued reads and waits until one of the reads in flight
+ * completes. Returns false if no read is in flight.
+ */
+bool uring_wait(Uring *ring, uint64_t *user_data, int *result);
+
+#endif
@@ -0,0 +1,116 @@
+#include "utf8.h"
+#include <stdint.h>
+#include "width-table.h"
+
+// Most text, even in other languages, is mostly ASCII (spaces, digits and
+// punctuation), and an ASCII byte is always one column wide. So the input is
+// first checked 16 bytes at a time with SSE2: a byte is ASCII when its highest
+// bit is clear, and `_mm_movemask_epi8` collects the highest bits of all 16
+// bytes into one mask. Only the bytes after a set bit are decoded one
+// character at a time.
+//
+// The width of a character is looked up in two steps in `width-table.h`
+// (generated by `width-table.py`): the character divided by 256 selects one of
+// a few distinct blocks of 256 widths, and the rest selects the width in the
+// block, stored in 2 bits.
+
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#endif
+
+size_t utf8_ascii_length(const char *text, size_t length) {
+    size_t i = 0;
+
+#if defined(__x86_64__)
+    for (; length - i >= 16; i += 16) {
+        unsigned mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(text + i)));
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+#endif
+    while (i < length && (unsigned char)text[i] < 0x80) i++;
+    return i;
+}
+
+// Decodes the character starting at `p`, returns the number of its bytes, or
+// 0 if it's not a valid sequence. The ranges allowed for the second byte
+// exclude overlong sequences, surrogates (U+D800..U+DFFF) and everything above
+// U+10FFFF.
+
+static int decode(const unsigned char *p, const unsigned char *end, uint32_t *code_point) {
+    unsigned char lead = p[0];
+    unsigned char low = 0x80, high = 0xBF;
+    int size;
+
+    if (lead < 0x80) {
+        *code_point = lead;
+        return 1;
+    } else if (lead < 0xC2) {
+        return 0;
+    } else if (lead < 0xE0) {
+        size = 2;
+        *code_point = lead & 0x1F;
+    } else if (lead < 0xF0) {
+        size = 3;
+        *code_point = lead & 0x0F;
+        if (lead == 0xE0) low = 0xA0;
+        if (lead == 0xED) high = 0x9F;
+    } else if (lead < 0xF5) {
+        size = 4;
+        *code_point = lead & 0x07;
+        if (lead == 0xF0) low = 0x90;
+        if (lead == 0xF4) high = 0x8F;
+    } else {
+        return 0;
+    }
+
+    if (end - p < size) return 0;
+    if (p[1] < low || p[1] > high) return 0;
+    for (int i = 1; i < size; ++i) {
+        if ((p[i] & 0xC0) != 0x80) return 0;
+        *code_point = (*code_point << 6) | (p[i] & 0x3F);
+    }
+    return size;
+}
+
+static int code_point_width(uint32_t code_point) {
+    uint8_t block = width_stage1[code_point >> WIDTH_BLOCK_SHIFT];
+    uint8_t packed = width_stage2[block][(code_point & 0xFF) >> 2];
+    return (packed >> (2 * (code_point & 3))) & 3;
+}
+
+bool utf8_validate(const char *text, size_t length) {
+    const unsigned char *p = (const unsigned char*)text;
+    const unsigned char *end = p + length;
+    uint32_t code_point;
+
+    while (p < end) {
+        p += utf8_ascii_length((const char*)p, end - p);
+        if (p == end) break;
+
+        // Decode the characters until the text is ASCII again.
+        do {
+            int size = decode(p, end, &code_point);
+            if (size == 0) return false;
+            p += size;
+        } while (p < end && *p >= 0x80);
+    }
+    return true;
+}
+
+int utf8_prefix(const char *text, int length, int max_width, int *width) {
+    const unsigned char *p = (const unsigned char*)text;
+    const unsigned char *end = p + length;
+    int total = 0;
+    uint32_t code_point;
+
+    while (p < end) {
+        int size = decode(p, end, &code_point);
+        int columns = size == 0 ? 1 : code_point_width(code_point);
+
+        if (total + columns > max_width) break;
+        total += columns;
+        p += size == 0 ? 1 : size;
+    }
+    *width = total;
+    return (const char*)p - text;
+}
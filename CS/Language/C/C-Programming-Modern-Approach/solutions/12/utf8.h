@@ -0,0 +1,33 @@
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Text in UTF-8 takes one to four bytes per character, and a character takes
+// zero (combining marks), one or two (East Asian wide characters) columns on
+// the screen, so neither the bytes nor the characters of a word say how wide
+// it is. These functions measure it.
+
+/*!
+ * @remark Returns the number of bytes at the beginning of `text` that are
+ * ASCII, `length` if all of them are.
+ */
+size_t utf8_ascii_length(const char *text, size_t length);
+
+/*!
+ * @remark Returns whether the `length` bytes of `text` are valid UTF-8: no
+ * stray continuation bytes, no cut or overlong sequences, no surrogates and
+ * nothing above U+10FFFF.
+ */
+bool utf8_validate(const char *text, size_t length);
+
+/*!
+ * @param [out] [width] The number of columns of the prefix.
+ * @remark Returns the length in bytes of the longest prefix of `text` that
+ * takes at most `max_width` columns and doesn't end in the middle of a
+ * character. A byte that doesn't start a valid sequence takes one column.
+ */
+int utf8_prefix(const char *text, int length, int max_width, int *width);
+
+#endif
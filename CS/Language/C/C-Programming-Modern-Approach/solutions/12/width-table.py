@@ -0,0 +1,71 @@
+# Generates width-table.h, the display width of every Unicode code point as a
+# two-stage lookup table, from the Unicode database of Python:
+#
+#   python3 width-table.py > width-table.h
+#
+# A code point is 0 columns wide if it's a combining or format character
+# (categories Mn, Me and Cf, except the soft hyphen) or a Hangul medial vowel
+# or final consonant, 2 columns wide if its East Asian Width is W or F, and 1
+# column wide otherwise.
+#
+# The code points are cut into blocks of 256. The first stage maps the number
+# of a block (code point >> 8) to one of the distinct blocks of the second
+# stage, which stores the widths of its 256 code points with 2 bits each. Most
+# blocks are all 1 or all 2, so few distinct blocks are needed.
+
+import sys
+import unicodedata
+
+BLOCK = 256
+PLANES = 0x110000 // BLOCK
+
+
+def width(code_point):
+    char = chr(code_point)
+    if 0x1160 <= code_point <= 0x11FF:
+        return 0
+    if code_point != 0xAD and unicodedata.category(char) in ("Mn", "Me", "Cf"):
+        return 0
+    if unicodedata.east_asian_width(char) in ("W", "F"):
+        return 2
+    return 1
+
+
+def main():
+    blocks = []
+    index = {}
+    stage1 = []
+
+    for block in range(PLANES):
+        packed = bytearray(BLOCK // 4)
+        for offset in range(BLOCK):
+            packed[offset // 4] |= width(block * BLOCK + offset) << (2 * (offset % 4))
+        packed = bytes(packed)
+        if packed not in index:
+            index[packed] = len(blocks)
+            blocks.append(packed)
+        stage1.append(index[packed])
+
+    assert len(blocks) <= 256
+
+    out = sys.stdout
+    out.write("// Generated by width-table.py from Unicode %s, don't edit.\n\n"
+              % unicodedata.unidata_version)
+    out.write("#ifndef WIDTH_TABLE_H\n#define WIDTH_TABLE_H\n\n#include <stdint.h>\n\n")
+    out.write("#define WIDTH_BLOCK_SHIFT 8\n\n")
+
+    out.write("static const uint8_t width_stage1[%d] = {\n" % len(stage1))
+    for i in range(0, len(stage1), 16):
+        out.write("    " + ", ".join("%d" % x for x in stage1[i:i + 16]) + ",\n")
+    out.write("};\n\n")
+
+    out.write("static const uint8_t width_stage2[%d][%d] = {\n" % (len(blocks), BLOCK // 4))
+    for packed in blocks:
+        out.write("    {\n")
+        for i in range(0, len(packed), 16):
+            out.write("        " + ", ".join("0x%02X" % x for x in packed[i:i + 16]) + ",\n")
+        out.write("    },\n")
+    out.write("};\n\n#endif\n")
+
+
+main()
@@ -1,4 +1,11 @@
+#include <errno.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "word.h"
 
 // int test_variable_header1 = 1;
@@ -10,10 +17,340 @@
 //     return test_variable_header1;
 // }
 
-char read_char(void) {
-    char ch = getchar();
-    if (ch == '\n' || ch == '\t') return ' ';
-    return ch;
+// Reading the input one `getchar` at a time costs a function call (and a lock
+// on the stream) for every byte. Instead the whole input is exposed as one
+// contiguous block of memory:
+//
+//   [+] A regular file is mapped into the address space with `mmap`, so the
+//       kernel pages it in on demand and nothing is copied at all;
+//   [+] Anything else (pipes, terminals) is read with `read` into a large
+//       buffer that is refilled when the scan reaches its end.
+//
+// Words are then handed out as spans (a pointer and a length) pointing into
+// that block of memory.
+
+#define READ_BUFFER_SIZE (1 << 20)
+
+static int input_fd = -1;
+static const char *input = NULL;
+static size_t input_length = 0;
+static size_t position = 0;
+
+static bool is_mapped = false;
+static bool reached_eof = false;
+static bool read_failed = false;
+static void *mapping = NULL;        // ← Starts at a page, `input` may start later.
+static size_t mapping_length = 0;
+static char *buffer = NULL;
+static size_t buffer_capacity = 0;
+
+static bool is_delimiter(char ch) {
+    return ch == ' ' || ch == '\n' || ch == '\t';
+}
+
+// Most of the time of reading is spent looking for the ends of words. With
+// SSE2 (16 bytes) or AVX2 (32 bytes) instructions a whole block of input is
+// compared against the three delimiters at once, giving a bit mask with one
+// bit per byte that is set for delimiters. The first word boundary in the
+// block is then the lowest set bit of the mask (or of its complement), found
+// with a single instruction. The end of the input that doesn't fill a block
+// is checked one byte at a time.
+//
+// AVX2 is used when the processor supports it (checked once at run time),
+// SSE2 is always there on x86-64, and other processors only use the scalar
+// loops. The environment variable JUSTIFY_SCANNER=scalar|sse2|avx2 forces a
+// choice, to compare them.
+
+typedef const char* (*Scanner)(const char *p, const char *end);
+
+static const char* find_delimiter_scalar(const char *p, const char *end) {
+    while (p < end && !is_delimiter(*p)) p++;
+    return p;
+}
+
+static const char* skip_delimiters_scalar(const char *p, const char *end) {
+    while (p < end && is_delimiter(*p)) p++;
+    return p;
+}
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+static inline unsigned delimiter_mask_sse2(const char *p) {
+    __m128i block = _mm_loadu_si128((const __m128i*)p);
+    __m128i found = _mm_or_si128(
+        _mm_or_si128(
+            _mm_cmpeq_epi8(block, _mm_set1_epi8(' ')),
+            _mm_cmpeq_epi8(block, _mm_set1_epi8('\n'))
+        ),
+        _mm_cmpeq_epi8(block, _mm_set1_epi8('\t'))
+    );
+    return _mm_movemask_epi8(found);
+}
+
+static const char* find_delimiter_sse2(const char *p, const char *end) {
+    for (; end - p >= 16; p += 16) {
+        unsigned mask = delimiter_mask_sse2(p);
+        if (mask != 0) return p + __builtin_ctz(mask);
+    }
+    return find_delimiter_scalar(p, end);
+}
+
+static const char* skip_delimiters_sse2(const char *p, const char *end) {
+    for (; end - p >= 16; p += 16) {
+        unsigned mask = ~delimiter_mask_sse2(p) & 0xFFFF;
+        if (mask != 0) return p + __builtin_ctz(mask);
+    }
+    return skip_delimiters_scalar(p, end);
+}
+
+__attribute__((target("avx2")))
+static inline unsigned delimiter_mask_avx2(const char *p) {
+    __m256i block = _mm256_loadu_si256((const __m256i*)p);
+    __m256i found = _mm256_or_si256(
+        _mm256_or_si256(
+            _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' ')),
+            _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n'))
+        ),
+        _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\t'))
+    );
+    return _mm256_movemask_epi8(found);
+}
+
+__attribute__((target("avx2")))
+static const char* find_delimiter_avx2(const char *p, const char *end) {
+    for (; end - p >= 32; p += 32) {
+        unsigned mask = delimiter_mask_avx2(p);
+        if (mask != 0) return p + __builtin_ctz(mask);
+    }
+    return find_delimiter_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char* skip_delimiters_avx2(const char *p, const char *end) {
+    for (; end - p >= 32; p += 32) {
+        unsigned mask = ~delimiter_mask_avx2(p);
+        if (mask != 0) return p + __builtin_ctz(mask);
+    }
+    return skip_delimiters_sse2(p, end);
+}
+#endif
+
+static Scanner find_delimiter = NULL;
+static Scanner skip_delimiters = NULL;
+
+static void select_scanner(void) {
+    const char *forced = getenv("JUSTIFY_SCANNER");
+
+    find_delimiter = find_delimiter_scalar;
+    skip_delimiters = skip_delimiters_scalar;
+    if (forced != NULL && strcmp(forced, "scalar") == 0) return;
+
+#if defined(__x86_64__)
+    find_delimiter = find_delimiter_sse2;
+    skip_delimiters = skip_delimiters_sse2;
+    if (forced != NULL && strcmp(forced, "sse2") == 0) return;
+
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        find_delimiter = find_delimiter_avx2;
+        skip_delimiters = skip_delimiters_avx2;
+    }
+#endif
+}
+
+void word_open(int fd) {
+    struct stat info;
+
+    word_close();
+    input_fd = fd;
+    if (find_delimiter == NULL) select_scanner();
+
+    // The input starts where the file offset is, which isn't always 0: a
+    // script may have read the first lines of the file before running us.
+    // `mmap` needs an offset at the start of a page, so the mapping starts
+    // at the page holding it.
+    off_t offset = lseek(fd, 0, SEEK_CUR);
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && offset >= 0) {
+        if (offset >= info.st_size) {
+            is_mapped = true;
+            reached_eof = true;
+            return;
+        }
+
+        off_t page_start = offset - offset % sysconf(_SC_PAGESIZE);
+        size_t length = info.st_size - page_start;
+        void *mapped = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, page_start);
+        if (mapped != MAP_FAILED) {
+            madvise(mapped, length, MADV_SEQUENTIAL);
+            mapping = mapped;
+            mapping_length = length;
+            input = (const char*)mapped + (offset - page_start);
+            input_length = info.st_size - offset;
+            is_mapped = true;
+            reached_eof = true;
+            return;
+        }
+    }
+
+    // Not a regular file, or the mapping failed: fall back to reading.
+
+    buffer_capacity = READ_BUFFER_SIZE;
+    buffer = (char*)malloc(buffer_capacity);
+    if (buffer == NULL) {
+        fprintf(stderr, "[Error] : malloc failed in <function:word_open>\n");
+        exit(EXIT_FAILURE);
+    }
+    input = buffer;
+}
+
+void word_close(void) {
+    if (mapping != NULL) munmap(mapping, mapping_length);
+    free(buffer);
+
+    input_fd = -1;
+    input = NULL;
+    input_length = 0;
+    position = 0;
+    is_mapped = false;
+    reached_eof = false;
+    read_failed = false;
+    mapping = NULL;
+    mapping_length = 0;
+    buffer = NULL;
+    buffer_capacity = 0;
+}
+
+// Keeps the bytes from `keep` to the end of the buffer (the beginning of a
+// word that has not been completely read yet), moves them to the front and
+// appends as much new input as fits after them. Returns false when there is
+// no more input.
+
+static bool refill(size_t keep) {
+    size_t kept = input_length - keep;
+
+    memmove(buffer, buffer + keep, kept);
+    input_length = kept;
+    position -= keep;
+
+    if (kept == buffer_capacity) {
+        // A single word fills the whole buffer, so make room for the rest.
+        char *larger = (char*)realloc(buffer, buffer_capacity * 2);
+        if (larger == NULL) {
+            fprintf(stderr, "[Error] : realloc failed in <function:refill>\n");
+            exit(EXIT_FAILURE);
+        }
+        buffer = larger;
+        buffer_capacity *= 2;
+        input = buffer;
+    }
+
+    while (true) {
+        ssize_t count = read(
+            input_fd, buffer + input_length, buffer_capacity - input_length
+        );
+        if (count > 0) {
+            input_length += count;
+            return true;
+        }
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) {
+            perror("[Error] : read failed in <function:refill>");
+            read_failed = true;     // ← The input ends here, but it's not the end.
+        }
+
+        reached_eof = true;
+        return false;
+    }
+}
+
+int next_word(const char **word) {
+    size_t start;
+
+    if (input_fd < 0) word_open(STDIN_FILENO);
+
+    while (true) {
+        // Skip until encountering non-space.
+        position = skip_delimiters(input + position, input + input_length) - input;
+        if (position < input_length || reached_eof) break;
+        if (!refill(position)) break;
+    }
+
+    start = position;
+    while (true) {
+        position = find_delimiter(input + position, input + input_length) - input;
+        if (position < input_length || reached_eof) break;
+
+        // The word may continue in the part of the input not read yet.
+        bool more = refill(start);
+        start = 0;
+        if (!more) break;
+    }
+
+    *word = input + start;
+    return position - start;
+}
+
+bool word_failed(void) {
+    return read_failed;
+}
+
+int scan_word(const char **cursor, const char *end, const char **word) {
+    const char *p = *cursor;
+
+    if (find_delimiter == NULL) select_scanner();
+    p = skip_delimiters(p, end);
+    *word = p;
+    p = find_delimiter(p, end);
+
+    *cursor = p;
+    return p - *word;
+}
+
+const char* find_word_end(const char *p, const char *end) {
+    if (find_delimiter == NULL) select_scanner();
+    return find_delimiter(p, end);
+}
+
+size_t next_block(const char **block, size_t size) {
+    size_t end;
+
+    if (input_fd < 0) word_open(STDIN_FILENO);
+
+    while (true) {
+        if (!is_mapped) {
+            if (buffer_capacity < size) {
+                char *larger = (char*)realloc(buffer, size);
+                if (larger == NULL) {
+                    fprintf(stderr, "[Error] : realloc failed in <function:next_block>\n");
+                    exit(EXIT_FAILURE);
+                }
+                buffer = larger;
+                buffer_capacity = size;
+                input = buffer;
+            }
+            while (input_length - position < size && !reached_eof)
+                refill(position);
+        }
+
+        end = position + size;
+        if (end >= input_length) {
+            end = input_length;
+            if (reached_eof) break;
+        }
+
+        // Cut the block after its last delimiter so no word is split.
+        while (end > position && !is_delimiter(input[end - 1])) end--;
+        if (end > position) break;
+
+        // A single word is longer than the whole block.
+        size *= 2;
+    }
+
+    size_t start = position;
+    *block = input + start;
+    position = end;
+    return end - start;
 }
 
 /*!
@@ -23,16 +360,10 @@ char read_char(void) {
  * `word[length]` is the null character `\0`
  */
 void read_word(char *word, int length) {
-    char ch;
-    int position = 0;
-
-    while ((ch = read_char()) == ' ');  // ← Read until encountering non-space.
-    while (ch != ' ' && ch != EOF) {
-        if (position < length) {
-            word[position] = ch;
-            position++;
-        }
-        ch = read_char();
-    }
-    word[position] = '\0';
+    const char *span;
+    int span_length = next_word(&span);
+
+    if (span_length > length) span_length = length;
+    memcpy(word, span, span_length);
+    word[span_length] = '\0';
 }
@@ -1,6 +1,11 @@
 #ifndef WORD_H
 #define WORD_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
+#define MAX_WORD_LENGTH 20
+
 // If a source file includes the same header file twice, compilation errors
 // may result. This problem is common when header files include other header
 // files, so use #define and #ifndef and together is to avoid this problem.
@@ -11,6 +16,60 @@
 //
 // int test_function_header1(void);
 
+/*!
+ * @param [in] [fd] The file descriptor to read words from.
+ * @remark Selects the input of the word reader, from the current offset of
+ * `fd` on. A regular file is mapped into memory, anything else is read
+ * through a large refillable buffer. If this is never called, the first read
+ * opens the standard input.
+ */
+void word_open(int fd);
+
+/*!
+ * @remark Releases the mapping or buffer of the word reader.
+ */
+void word_close(void);
+
+/*!
+ * @remark Returns true if reading the input failed, so that the words read
+ * before were not all of it. Reset by `word_open` and `word_close`.
+ */
+bool word_failed(void);
+
+/*!
+ * @param [out] [word] Points to the first character of the next word, the word
+ * is not null-terminated.
+ * @remark Returns the length of the next word, or 0 if no word could be read
+ * because of end-of-file. The word is not copied, so it's only valid until the
+ * next call.
+ */
+int next_word(const char **word);
+
+/*!
+ * @param [in,out] [cursor] Where to start scanning, moved past the word.
+ * @param [in] [end] The end of the memory to scan.
+ * @param [out] [word] Points to the first character of the word.
+ * @remark Returns the length of the next word in the memory from `cursor` to
+ * `end`, or 0 if there's none. Unlike `next_word` it only uses its arguments,
+ * so it can be called from several threads.
+ */
+int scan_word(const char **cursor, const char *end, const char **word);
+
+/*!
+ * @remark Returns a pointer to the first delimiter from `p` to `end`, or `end`
+ * if there's none. Like `scan_word` it can be called from several threads.
+ */
+const char* find_word_end(const char *p, const char *end);
+
+/*!
+ * @param [out] [block] Points to the first character of the block.
+ * @param [in] [size] The wanted size of the block.
+ * @remark Returns the length of the next block of raw input, about `size`
+ * bytes long and never ending in the middle of a word, or 0 at end-of-file.
+ * The block is only valid until the next call.
+ */
+size_t next_block(const char **block, size_t size);
+
 /*!
  * @param [out] [word] Reads the next word from the input and stores it in `word`.
  * Makes word empty if no word could be read because of end-of-file. Truncates
@@ -0,0 +1,73 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <string.h>
+
+// An arena hands out pieces of one block of memory given to it (an array on
+// the C stack, a static buffer or a single `malloc`) by moving a cursor
+// forward, and takes them all back at once with `arena_reset`. Nothing is
+// freed one piece at a time, so a program that builds many small things for
+// one task and then forgets them all never calls `malloc` or `free` for them.
+//
+// Like `stack.h`, everything is in this header, so a solution that uses it is
+// still compiled on its own, for example `gcc 03-reverse-polish-notation.c`.
+
+typedef struct {
+    char *memory;
+    size_t used;
+    size_t capacity;
+} Arena;
+
+#define ARENA_ALIGNMENT 16
+
+/*!
+ * @param [in] [memory] The `capacity` bytes the arena hands out, which must
+ * live as long as the arena is used.
+ */
+static inline void arena_init(Arena *arena, void *memory, size_t capacity) {
+    arena->memory = (char*)memory;
+    arena->used = 0;
+    arena->capacity = capacity;
+}
+
+/*!
+ * @remark Returns `size` bytes aligned to ARENA_ALIGNMENT, or NULL if the arena
+ * doesn't have that many left.
+ */
+static inline void* arena_alloc(Arena *arena, size_t size) {
+    size_t start = (arena->used + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+
+    if (start > arena->capacity || size > arena->capacity - start) return NULL;
+    arena->used = start + size;
+    return arena->memory + start;
+}
+
+/*!
+ * @param [in] [block] A piece of `old_size` bytes from `arena_alloc`.
+ * @remark Returns a piece of `new_size` bytes holding the same data: the same
+ * piece if it's the last one handed out and there's room after it, a new one
+ * otherwise (the old one is only taken back by `arena_reset`), or NULL if the
+ * arena is full.
+ */
+static inline void* arena_resize(Arena *arena, void *block, size_t old_size, size_t new_size) {
+    char *bytes = (char*)block;
+
+    if (bytes + old_size == arena->memory + arena->used && new_size <= arena->capacity - (bytes - arena->memory)) {
+        arena->used = (bytes - arena->memory) + new_size;
+        return block;
+    }
+
+    void *larger = arena_alloc(arena, new_size);
+    if (larger != NULL) memcpy(larger, block, old_size < new_size ? old_size : new_size);
+    return larger;
+}
+
+/*!
+ * @remark Takes back everything handed out by the arena.
+ */
+static inline void arena_reset(Arena *arena) {
+    arena->used = 0;
+}
+
+#endif
@@ -0,0 +1,258 @@
+#ifndef NUMBER_H
+#define NUMBER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "power5-table.h"
+
+// Reads a decimal number like `strtod` does, to the nearest double, but much
+// faster. Building the value digit by digit with `num += digit * scale` and
+// `scale *= 0.1` rounds at every step (0.1 isn't even exact in binary), so
+// the result is often a little off, and it's slow. Here the digits are first
+// read as one exact integer w, with the power of ten e they're multiplied
+// by, and only then converted, rounding once:
+//
+//   [+] Eight digits at a time are checked and converted with a few integer
+//       operations on a 64-bit word holding them (SWAR, SIMD within a
+//       register), instead of one multiplication per digit;
+//   [+] If w < 2^53 and |e| <= 22, w and 10^e are both exact doubles, so
+//       a single multiplication or division rounds correctly (Clinger);
+//   [+] Otherwise w * 10^e = w * 5^e * 2^e, and the first 128 bits of the
+//       product of w and 5^e (see `power5-table.h`) are always enough to
+//       know the 53 bits of the double and how they round (the algorithm of
+//       Eisel and Lemire, as in the fast_float library).
+//
+// Numbers with more than 19 significant digits, which don't fit in w, and
+// anything that doesn't start like a decimal number (spaces, "inf", "nan",
+// hexadecimal) are left to `strtod`, which gives the same results.
+//
+// Like `stack.h`, everything is in this header, so a solution that uses it is
+// still compiled on its own.
+
+#define NUMBER_MAX_DIGITS 19
+
+static inline bool number_is_digit(char ch) {
+    return ch >= '0' && ch <= '9';
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define NUMBER_SWAR 1
+
+// Whether all the 8 bytes of `word` are '0' to '9': each byte must be 0x3X,
+// and stay 0x3X when 6 is added to it.
+
+static inline bool number_is_eight_digits(uint64_t word) {
+    return (
+        ((word & 0xF0F0F0F0F0F0F0F0ULL) |
+        (((word + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4))
+    ) == 0x3333333333333333ULL;
+}
+
+// The value of 8 digits, the first one in the lowest byte: pairs of digits
+// are combined into numbers of 0 to 99, then pairs of those into 0 to 9999,
+// and the two halves at last.
+
+static inline uint32_t number_eight_digits(uint64_t word) {
+    const uint64_t mask = 0x000000FF000000FFULL;
+    const uint64_t mul1 = 100 + (1000000ULL << 32);
+    const uint64_t mul2 = 1 + (10000ULL << 32);
+
+    word -= 0x3030303030303030ULL;
+    word = word * 10 + (word >> 8);
+    word = ((word & mask) * mul1 + ((word >> 16) & mask) * mul2) >> 32;
+    return (uint32_t)word;
+}
+#endif
+
+// Reads digits into `*w` from `p`, returns where they end.
+
+static inline const char* number_digits(const char *p, const char *end, uint64_t *w) {
+#ifdef NUMBER_SWAR
+    while (end - p >= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        if (!number_is_eight_digits(word)) break;
+        *w = *w * 100000000 + number_eight_digits(word);
+        p += 8;
+    }
+#endif
+    while (p < end && number_is_digit(*p)) {
+        *w = *w * 10 + (*p - '0');
+        p++;
+    }
+    return p;
+}
+
+static inline double number_from_bits(uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// w * 10^q for w < 2^64 and w != 0, rounded to the nearest double (ties to
+// even). The 128-bit products are computed with `unsigned __int128`.
+
+static inline double number_eisel_lemire(uint64_t w, int q) {
+    if (q < POWER5_SMALLEST) return 0.0;
+    if (q > POWER5_LARGEST) return number_from_bits(0x7FF0000000000000ULL);
+
+    int leading_zeros = __builtin_clzll(w);
+    w <<= leading_zeros;
+
+    const uint64_t *power = &power5_table[2 * (q - POWER5_SMALLEST)];
+    unsigned __int128 product = (unsigned __int128)w * power[0];
+    uint64_t high = product >> 64, low = (uint64_t)product;
+
+    // The 9 bits below the 55 that are kept are all ones, so the lower half
+    // of the power may still carry into them.
+    if ((high & 0x1FF) == 0x1FF) {
+        unsigned __int128 second = (unsigned __int128)w * power[1];
+        uint64_t second_high = second >> 64;
+        low += second_high;
+        if (second_high > low) high++;
+    }
+
+    int upper_bit = high >> 63;
+    uint64_t mantissa = high >> (upper_bit + 9);
+    // floor(log2(10^q)) = floor(q * log2(10)), for |q| up to 1300 or so.
+    int power2 = (((152170 + 65536) * q) >> 16) + 63 + upper_bit - leading_zeros + 1023;
+
+    if (power2 <= 0) {
+        // A subnormal number, or 0.
+        if (-power2 + 1 >= 64) return 0.0;
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        power2 = mantissa < (1ULL << 52) ? 0 : 1;
+        return number_from_bits((uint64_t)power2 << 52 | (mantissa & ((1ULL << 52) - 1)));
+    }
+
+    // Exactly halfway between two doubles, which only happens for small q:
+    // round to even instead of up.
+    if (low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1) {
+        if ((mantissa << (upper_bit + 9)) == high) mantissa &= ~1ULL;
+    }
+
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= (2ULL << 52)) {
+        mantissa = 1ULL << 52;
+        power2++;
+    }
+    mantissa &= ~(1ULL << 52);
+    if (power2 >= 0x7FF) return number_from_bits(0x7FF0000000000000ULL);
+    return number_from_bits((uint64_t)power2 << 52 | mantissa);
+}
+
+// Leaves the number to `strtod`, which needs a string that ends with '\0': a
+// copy of what may be part of it (spaces, then letters, digits and signs).
+
+static inline const char* number_fall_back(const char *text, const char *end, double *value) {
+    const char *last = text;
+    while (last < end && (*last == ' ' || *last == '\t' || *last == '\n' || *last == '\r'))
+        last++;
+    while (
+        last < end && (
+            (*last >= '0' && *last <= '9') || (*last >= 'a' && *last <= 'z') ||
+            (*last >= 'A' && *last <= 'Z') || *last == '.' || *last == '+' || *last == '-'
+        )
+    ) {
+        last++;
+    }
+
+    size_t length = last - text;
+    char small[64];
+    char *copy = length < sizeof(small) ? small : (char*)malloc(length + 1);
+    char *stop;
+
+    if (copy == NULL) {
+        *value = 0.0;
+        return text;
+    }
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    *value = strtod(copy, &stop);
+    if (copy != small) free(copy);
+    return text + (stop - copy);
+}
+
+/*!
+ * @param [in] [text] The number, optionally signed, with an optional
+ * fraction after '.' and an optional exponent after 'e' or 'E', followed by
+ * anything else. Nothing at or after `end` is read.
+ * @param [out] [value] The nearest double to it.
+ * @remark Returns where the number ends, or `text` if there's no number there,
+ * exactly like the `endptr` of `strtod`.
+ */
+static inline const char* number_parse(const char *text, const char *end, double *value) {
+    const char *p = text;
+    bool negative = false;
+    uint64_t w = 0;
+    int exponent = 0;
+
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+    if (end - p >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+        return number_fall_back(text, end, value);
+
+    const char *digits = p;
+    p = number_digits(p, end, &w);
+    int num_of_digits = p - digits;
+
+    if (p < end && *p == '.') {
+        const char *fraction = ++p;
+        p = number_digits(p, end, &w);
+        exponent = -(int)(p - fraction);
+        num_of_digits += p - fraction;
+    }
+    if (num_of_digits == 0) return number_fall_back(text, end, value);
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *e = p + 1;
+        bool negative_exponent = false;
+        int written = 0;
+
+        if (e < end && (*e == '-' || *e == '+')) negative_exponent = *e++ == '-';
+        if (e < end && number_is_digit(*e)) {
+            while (e < end && number_is_digit(*e)) {
+                if (written < 100000) written = written * 10 + (*e - '0');
+                e++;
+            }
+            exponent += negative_exponent ? -written : written;
+            p = e;
+        }
+    }
+
+    if (num_of_digits > NUMBER_MAX_DIGITS) {
+        // Leading zeros ("0.000123") aren't significant.
+        for (const char *z = digits; z < p && (*z == '0' || *z == '.'); ++z) {
+            if (*z == '0') num_of_digits--;
+        }
+        if (num_of_digits > NUMBER_MAX_DIGITS) return number_fall_back(text, end, value);
+    }
+
+    static const double powers_of_ten[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    double result;
+
+    if (w == 0) {
+        result = 0.0;
+    } else if (w <= 1ULL << 53 && exponent >= -22 && exponent <= 22) {
+        result = (double)w;
+        if (exponent < 0) {
+            result /= powers_of_ten[-exponent];
+        } else {
+            result *= powers_of_ten[exponent];
+        }
+    } else {
+        result = number_eisel_lemire(w, exponent);
+    }
+    *value = negative ? -result : result;
+    return p;
+}
+
+#endif
@@ -0,0 +1,54 @@
+# Generates power5-table.h, the powers of five used by number.h to convert
+# decimal numbers to binary:
+#
+#   python3 power5-table.py > power5-table.h
+#
+# For every q from -342 to 308, 5^q is written as a 128-bit number whose
+# highest bit is set, times a power of two: the first 128 bits of 5^q,
+# truncated, for q >= 0, and of 2^b / 5^-q, rounded up, for q < 0 (the same
+# values as the fast_float library). A double between 10^-342 and 10^308 is
+# then the product of its decimal digits and one of these, shifted.
+
+import sys
+
+SMALLEST = -342
+LARGEST = 308
+
+
+def power5(q):
+    if q >= 0:
+        value = 5 ** q
+        while value < 1 << 127:
+            value *= 2
+        while value >= 1 << 128:
+            value //= 2
+        return value
+
+    power = 5 ** -q
+    z = 0
+    while (1 << z) < power:
+        z += 1
+    if q >= -27:
+        b = z + 127
+        return 2 ** b // power + 1
+    b = 2 * z + 2 * 64
+    value = 2 ** b // power + 1
+    while value >= 1 << 128:
+        value //= 2
+    return value
+
+
+def main():
+    out = sys.stdout
+    out.write("// Generated by power5-table.py, don't edit.\n\n")
+    out.write("#ifndef POWER5_TABLE_H\n#define POWER5_TABLE_H\n\n#include <stdint.h>\n\n")
+    out.write("#define POWER5_SMALLEST %d\n#define POWER5_LARGEST %d\n\n" % (SMALLEST, LARGEST))
+    out.write("// The high and the low 64 bits of each power, from 5^%d.\n\n" % SMALLEST)
+    out.write("static const uint64_t power5_table[%d] = {\n" % (2 * (LARGEST - SMALLEST + 1)))
+    for q in range(SMALLEST, LARGEST + 1):
+        value = power5(q)
+        out.write("    0x%016XULL, 0x%016XULL,\n" % (value >> 64, value & ((1 << 64) - 1)))
+    out.write("};\n\n#endif\n")
+
+
+main()
@@ -0,0 +1,123 @@
+#ifndef STACK_H
+#define STACK_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+// A stack kept as one array instead of a linked list of nodes. A linked
+// stack calls `malloc` for every push (and `free` for every pop, or leaks the
+// node), and its nodes are scattered in memory. Here the items are side by
+// side and pushing only writes the next one, until the array is full:
+//
+//   [+] The first `inline_capacity` items are kept in the stack itself, so a
+//       stack declared as a local variable that stays that small never
+//       allocates anything;
+//   [+] Past that the array doubles whenever it's full, so pushing n items
+//       copies fewer than 2n of them in all;
+//   [+] With `_init_arena`, the larger arrays are taken from an arena (see
+//       `arena.h`) instead of `malloc`, and when the arena is full the stack
+//       goes on with `malloc`.
+//
+// C has no templates, so STACK_DEFINE writes the type and the functions of a
+// stack of one type of items:
+//
+//   STACK_DEFINE(NumStack, num_stack, double, 32)
+//
+//   NumStack stack;
+//   num_stack_init(&stack);
+//   num_stack_push(&stack, 1.5);
+//   double top = num_stack_pop(&stack);
+//   num_stack_free(&stack);
+//
+// The items are stack.items[0] (the bottom) to stack.items[stack.length - 1]
+// (the top). A stack points into itself while it's small, so it must not be
+// copied by value (pass pointers to it), and `_pop` and `_top` must not be
+// called on an empty stack.
+
+#define STACK_DEFINE(Name, prefix, Type, inline_capacity)                      \
+    typedef struct {                                                            \
+        Type *items;                                                            \
+        int length;                                                             \
+        int capacity;                                                           \
+        Arena *arena;           /* ← Where larger arrays come from, or NULL. */ \
+        Type small[inline_capacity];                                            \
+    } Name;                                                                     \
+                                                                                \
+    static inline void prefix##_init(Name *stack) {                             \
+        stack->items = stack->small;                                            \
+        stack->length = 0;                                                      \
+        stack->capacity = inline_capacity;                                      \
+        stack->arena = NULL;                                                    \
+    }                                                                           \
+                                                                                \
+    static inline void prefix##_init_arena(Name *stack, Arena *arena) {         \
+        prefix##_init(stack);                                                   \
+        stack->arena = arena;                                                   \
+    }                                                                           \
+                                                                                \
+    static inline void prefix##_free(Name *stack) {                             \
+        if (stack->items != stack->small && stack->arena == NULL)               \
+            free(stack->items);                                                 \
+        stack->items = stack->small;                                            \
+        stack->length = 0;                                                      \
+        stack->capacity = inline_capacity;                                      \
+    }                                                                           \
+                                                                                \
+    /* Doubles the array, out of line of `_push` since it's so rare. */         \
+    __attribute__((noinline))                                                   \
+    static void prefix##_grow(Name *stack) {                                    \
+        size_t old_size = (size_t)stack->capacity * sizeof(Type);               \
+        Type *larger = NULL;                                                    \
+                                                                                \
+        if (stack->arena != NULL) {                                             \
+            larger = stack->items == stack->small                               \
+                ? (Type*)arena_alloc(stack->arena, 2 * old_size)                \
+                : (Type*)arena_resize(stack->arena, stack->items, old_size, 2 * old_size); \
+            if (larger != NULL && stack->items == stack->small)                 \
+                memcpy(larger, stack->small, old_size);                         \
+            if (larger == NULL) {                                               \
+                /* The arena is full, the stack moves to the heap. */           \
+                larger = (Type*)malloc(2 * old_size);                           \
+                if (larger != NULL) memcpy(larger, stack->items, old_size);     \
+                stack->arena = NULL;                                            \
+            }                                                                   \
+        } else if (stack->items == stack->small) {                              \
+            larger = (Type*)malloc(2 * old_size);                               \
+            if (larger != NULL) memcpy(larger, stack->small, old_size);         \
+        } else {                                                                \
+            larger = (Type*)realloc(stack->items, 2 * old_size);                \
+        }                                                                       \
+                                                                                \
+        if (larger == NULL) {                                                   \
+            fprintf(stderr, "[Error] : malloc failed in <function:" #prefix "_grow>\n"); \
+            exit(EXIT_FAILURE);                                                 \
+        }                                                                       \
+        stack->items = larger;                                                  \
+        stack->capacity *= 2;                                                   \
+    }                                                                           \
+                                                                                \
+    static inline bool prefix##_is_empty(const Name *stack) {                   \
+        return stack->length == 0;                                              \
+    }                                                                           \
+                                                                                \
+    static inline void prefix##_push(Name *stack, Type item) {                  \
+        if (stack->length == stack->capacity) prefix##_grow(stack);             \
+        stack->items[stack->length++] = item;                                   \
+    }                                                                           \
+                                                                                \
+    static inline Type prefix##_pop(Name *stack) {                              \
+        return stack->items[--stack->length];                                   \
+    }                                                                           \
+                                                                                \
+    static inline Type prefix##_top(const Name *stack) {                        \
+        return stack->items[stack->length - 1];                                 \
+    }                                                                           \
+                                                                                \
+    static inline void prefix##_clear(Name *stack) {                            \
+        stack->length = 0;                                                      \
+    }
+
+#endif